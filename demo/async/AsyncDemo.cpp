@@ -0,0 +1,58 @@
+#include "app.h"
+#include <Async.h>
+#include <Format.h>
+#include <avr/AsyncI2c.h>
+#include <avr/BoardSelector.h>
+
+using namespace liquid;
+
+static auto led = Board::makeGpio(Board::Gpio::BuiltInLed);
+
+// -----------------------------------------------------------------------------
+
+static auto blink() -> Task<>
+{
+    while (true) {
+        led.toggle();
+        co_await sleepFor(500);
+    }
+}
+
+// Polls the AHT20 status byte, the blinking goes on while the bus is busy
+static auto readStatus(AsyncI2c &i2c) -> Task<>
+{
+    constexpr uint8_t address = 0x38;
+
+    while (true) {
+        uint8_t    status = 0;
+        const auto result = co_await i2c.read(address, &status, 1);
+        if (result == AvrI2c::Status::Ok) {
+            print(FORMAT_STR("AHT20 status 0x{:02x}\r\n"), status);
+        } else {
+            print(FORMAT_STR("AHT20 error {}\r\n"), static_cast<int>(result));
+        }
+        co_await sleepFor(1000);
+    }
+}
+
+auto appMain() -> void
+{
+    led.asOutput();
+
+    SysTimer  sysTimer;
+    AvrTimer8 timer0 = Board::makeTimer8(Timer8Id::Timer0);
+    sysTimer.setupWith(timer0, F_CPU, 1000);
+
+    AvrI2cController bus;
+    constexpr auto   config = AvrI2c::configureBitrate(F_CPU, 100000);
+    static_assert(config.isValid);
+    bus.apply(config);
+
+    AsyncI2c i2c {bus};
+    Executor executor {sysTimer};
+    executor.spawn(blink());
+    executor.spawn(readStatus(i2c));
+
+    Sys::enableInterrupts();
+    executor.run();
+}
@@ -9,7 +9,7 @@ using namespace liquid;
 
 constexpr static auto uartBaudRate = 19200L;
 
-static Usart console = Board::makeUsart(0);
+static Usart console = Board::makeUsart<0>();
 
 /* -------------------------------------------------------------------------- */
 
@@ -35,7 +35,7 @@ extern "C" void __cxa_pure_virtual()
 
 void setupSystem()
 {
-    console.setupUart(F_CPU, uartBaudRate);
+    console.setupUart(Usart::Impl::configureBaud<F_CPU, uartBaudRate>());
     liquid::installAsStdStreams(console);
 }
 
@@ -1,8 +1,10 @@
 #include "app.h"
 #include <Eeprom.h>
+#include <Format.h>
 #include <Sys.h>
 #include <avr/BoardSelector.h>
 
+#include <avr/pgmspace.h>
 #include <stdio.h>
 #include <string.h>
 #include <util/delay.h>
@@ -33,12 +35,12 @@ auto appMain() -> void
     uint8_t x = Eeprom::readByte(0x0005);
     Eeprom::readStruct(0x0006, s);
 
-    printf("x = %d\r\n", x);
-    printf("settings = { 0x%04X, '%s' }\n\r", s.id, s.name);
+    printf_P(PSTR("x = %d\r\n"), x);
+    printf_P(PSTR("settings = { 0x%04X, '%s' }\n\r"), s.id, s.name);
 
     ++x;
     ++s.id;
-    snprintf(s.name, sizeof(s.name), "hi %d", s.id);
+    formatTo(s.name, sizeof(s.name), FORMAT_STR("hi {}"), s.id);
     
     _delay_ms(1000);
     Eeprom::writeByte(0x0005, x);
@@ -1,6 +1,8 @@
 #include "app.h"
+#include <Format.h>
 #include <avr/BoardSelector.h>
 
+#include <avr/pgmspace.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -176,7 +178,7 @@ auto appMain() -> void
     while (true) {
         Board::makeGpio(BoardConfig::led).toggle();
         _delay_ms(2000);
-        printf("t=%lu\n\r", sysTimer.getTime());
+        print(FORMAT_STR("t={}\n\r"), sysTimer.getTime());
     }
         
 }
@@ -0,0 +1,530 @@
+#ifndef LIQUID_ASYNC_H_
+#define LIQUID_ASYNC_H_
+
+#include "RingBuffer.h"
+#include "Sys.h"
+#include "SysTimer.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef __cpp_impl_coroutine
+#error "Async.h needs coroutines: C++20, or -fcoroutines with GCC 10, see LIQUID_ASYNC"
+#endif
+
+// Coroutine frames, allocated from a static pool. A coroutine whose frame
+// does not fit fails to start, see Task::isValid().
+#ifndef LIQUID_ASYNC_FRAMES
+#define LIQUID_ASYNC_FRAMES 4
+#endif
+
+#ifndef LIQUID_ASYNC_FRAME_SIZE
+#define LIQUID_ASYNC_FRAME_SIZE (48 * sizeof(void *))
+#endif
+
+// Coroutines ready to resume, at most one entry for each frame
+#ifndef LIQUID_ASYNC_READY_SIZE
+#define LIQUID_ASYNC_READY_SIZE 8
+#endif
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+// avr-libc has no C++ standard library. This is the part of <coroutine> the
+// compiler relies on, over the same builtins as libstdc++.
+namespace std
+{
+
+template <class R, class... Args> struct coroutine_traits {
+    using promise_type = typename R::promise_type;
+};
+
+template <class Promise = void> struct coroutine_handle;
+
+template <> struct coroutine_handle<void> {
+    constexpr coroutine_handle() noexcept = default;
+    constexpr coroutine_handle(decltype(nullptr)) noexcept {}
+
+    static auto from_address(void *address) noexcept -> coroutine_handle
+    {
+        coroutine_handle h;
+        h.frame = address;
+        return h;
+    }
+
+    constexpr auto address() const noexcept -> void * { return frame; }
+    constexpr explicit operator bool() const noexcept { return frame != nullptr; }
+
+    auto done() const noexcept -> bool { return __builtin_coro_done(frame); }
+    auto operator()() const -> void { resume(); }
+    auto resume() const -> void { __builtin_coro_resume(frame); }
+    auto destroy() const -> void { __builtin_coro_destroy(frame); }
+
+protected:
+    void *frame = nullptr;
+};
+
+template <class Promise> struct coroutine_handle : coroutine_handle<> {
+    constexpr coroutine_handle() noexcept = default;
+    constexpr coroutine_handle(decltype(nullptr)) noexcept {}
+
+    static auto from_address(void *address) noexcept -> coroutine_handle
+    {
+        coroutine_handle h;
+        h.frame = address;
+        return h;
+    }
+
+    static auto from_promise(Promise &promise) noexcept -> coroutine_handle
+    {
+        return from_address(__builtin_coro_promise(reinterpret_cast<char *>(&promise),
+                                                   __alignof(Promise), true));
+    }
+
+    auto promise() const -> Promise &
+    {
+        return *static_cast<Promise *>(__builtin_coro_promise(frame, __alignof(Promise), false));
+    }
+};
+
+struct suspend_always {
+    constexpr auto await_ready() const noexcept -> bool { return false; }
+    constexpr auto await_suspend(coroutine_handle<>) const noexcept -> void {}
+    constexpr auto await_resume() const noexcept -> void {}
+};
+
+struct suspend_never {
+    constexpr auto await_ready() const noexcept -> bool { return true; }
+    constexpr auto await_suspend(coroutine_handle<>) const noexcept -> void {}
+    constexpr auto await_resume() const noexcept -> void {}
+};
+
+} // namespace std
+#endif
+
+namespace liquid
+{
+
+/*
+ * Fixed size blocks for the coroutine frames, nothing comes from the heap.
+ * Used from the main context only.
+ */
+class FramePool
+{
+public:
+    static constexpr size_t frameSize = LIQUID_ASYNC_FRAME_SIZE;
+    static constexpr int    count = LIQUID_ASYNC_FRAMES;
+
+    static auto allocate(size_t size) -> void *
+    {
+        if (size > frameSize) return nullptr;
+        for (int i = 0; i < count; ++i) {
+            if (!used[i]) {
+                used[i] = true;
+                return frames[i].bytes;
+            }
+        }
+        return nullptr;
+    }
+
+    static auto release(void *frame) -> void
+    {
+        for (int i = 0; i < count; ++i) {
+            if (frames[i].bytes == frame) used[i] = false;
+        }
+    }
+
+    static auto getFreeCount() -> int
+    {
+        int n = 0;
+        for (const auto u : used)
+            n += u ? 0 : 1;
+        return n;
+    }
+
+private:
+    struct Frame {
+        alignas(alignof(long double)) uint8_t bytes[frameSize];
+    };
+
+    static inline Frame frames[count] {};
+    static inline bool  used[count] {};
+};
+
+class Executor;
+
+// Something a coroutine waits for, checked by the executor after each wake-up.
+// Once isReady() returned true, it must keep doing so.
+struct AsyncWait {
+    using ReadyFunc = auto (*)(AsyncWait &wait) -> bool;
+
+    ReadyFunc               isReady {nullptr};
+    std::coroutine_handle<> handle {};
+    AsyncWait              *next {nullptr};
+};
+
+struct PromiseBase {
+    Executor               *executor {nullptr};
+    std::coroutine_handle<> continuation {};
+    bool                    detached {false};
+
+    // Without exceptions, a coroutine that doesn't get a frame returns an invalid Task
+    static auto operator new(size_t size) noexcept -> void * { return FramePool::allocate(size); }
+    static auto operator delete(void *frame) -> void { FramePool::release(frame); }
+
+    // Tasks start when awaited or spawned
+    auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+
+    struct FinalAwaiter {
+        auto await_ready() const noexcept -> bool { return false; }
+        template <class P> auto await_suspend(std::coroutine_handle<P> h) noexcept -> void;
+        auto await_resume() const noexcept -> void {}
+    };
+
+    auto final_suspend() noexcept -> FinalAwaiter { return {}; }
+
+    auto unhandled_exception() -> void { assert(0); }
+};
+
+template <class T> struct TaskPromise : PromiseBase {
+    T value {};
+
+    auto return_value(const T &value_) -> void { value = value_; }
+    auto result() -> T { return value; }
+    static auto failed() -> T { return T {}; }
+};
+
+template <> struct TaskPromise<void> : PromiseBase {
+    auto return_void() -> void {}
+    auto result() -> void {}
+    static auto failed() -> void {}
+};
+
+/*
+ * Coroutine returning T. It starts when awaited by another coroutine, or when
+ * spawned on an Executor.
+ *
+ *     auto readSensor(AsyncI2c &i2c) -> Task<int>
+ *     {
+ *         co_await i2c.write(address, Cmd::measure, sizeof(Cmd::measure));
+ *         co_await sleepFor(80);
+ *         ...
+ *         co_return value;
+ *     }
+ */
+template <class T = void> class Task
+{
+public:
+    struct promise_type : TaskPromise<T> {
+        auto get_return_object() -> Task
+        {
+            return Task {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        static auto get_return_object_on_allocation_failure() -> Task { return Task {}; }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    Task(Task &&other) : handle(other.release()) {}
+    Task(const Task &) = delete;
+    ~Task() { reset(); }
+
+    auto operator=(Task &&other) -> Task &
+    {
+        if (this != &other) {
+            reset();
+            handle = other.release();
+        }
+        return *this;
+    }
+
+    auto operator=(const Task &) -> Task & = delete;
+
+    // False when no frame was free, or the frame was too small
+    auto isValid() const -> bool { return static_cast<bool>(handle); }
+
+    auto release() -> Handle
+    {
+        const auto h = handle;
+        handle = nullptr;
+        return h;
+    }
+
+    struct Awaiter {
+        Handle child;
+
+        auto await_ready() const noexcept -> bool { return !child || child.done(); }
+
+        template <class P> auto await_suspend(std::coroutine_handle<P> parent) -> void
+        {
+            child.promise().executor = parent.promise().executor;
+            child.promise().continuation = parent;
+            child.resume();
+        }
+
+        auto await_resume() -> T
+        {
+            assert(child); // Raise LIQUID_ASYNC_FRAMES or LIQUID_ASYNC_FRAME_SIZE
+            return child ? child.promise().result() : promise_type::failed();
+        }
+    };
+
+    auto operator co_await() const noexcept -> Awaiter { return {handle}; }
+
+private:
+    Handle handle {nullptr};
+
+    explicit Task(Handle handle_) : handle(handle_) {}
+
+    auto reset() -> void
+    {
+        if (handle) handle.destroy();
+        handle = nullptr;
+    }
+};
+
+/*
+ * Runs the coroutines. Completions posted from interrupts resume them from
+ * the main loop, and between wake-ups the CPU sleeps.
+ *
+ *     Executor executor {sysTimer};
+ *     executor.spawn(blink());
+ *     executor.spawn(readSensors());
+ *     executor.run();
+ */
+class Executor
+{
+public:
+    explicit Executor(SysTimer &clock_) : clock(clock_) {}
+
+    Executor(const Executor &) = delete;
+    auto operator=(const Executor &) -> Executor & = delete;
+
+    // The executor owns the coroutine from now on. False if it has no frame.
+    auto spawn(Task<> task) -> bool
+    {
+        const auto h = task.release();
+        if (!h) return false;
+
+        h.promise().executor = this;
+        h.promise().detached = true;
+        post(h);
+        return true;
+    }
+
+    // Make a coroutine ready to resume, from any context
+    auto post(std::coroutine_handle<> h) -> void
+    {
+        NoInterruptsGuard guard;
+        const auto        queued = ready.push(h);
+        assert(queued);
+        static_cast<void>(queued);
+    }
+
+    // From the main context
+    auto wait(AsyncWait &w) -> void
+    {
+        w.next = waiting;
+        waiting = &w;
+    }
+
+    // Resume everything that can go on without sleeping. False if nothing could.
+    auto runOnce() -> bool
+    {
+        // Satisfied waits join the ready queue
+        for (AsyncWait **w = &waiting; *w != nullptr;) {
+            if ((*w)->isReady(**w)) {
+                post((*w)->handle);
+                *w = (*w)->next;
+            } else {
+                w = &(*w)->next;
+            }
+        }
+
+        // Only the ones ready now, what they post runs in the next round
+        const auto count = ready.size();
+        for (uint8_t i = 0; i < count; ++i) {
+            std::coroutine_handle<> h;
+            ready.pop(h);
+            h.resume();
+        }
+        return count != 0;
+    }
+
+    // Never returns, sleeps whenever no coroutine can go on
+    auto run() -> void
+    {
+        while (true) {
+            Sys::waitUntil([&] { return hasWork(); });
+            runOnce();
+        }
+    }
+
+    auto getTime() -> unsigned long { return clock.getTime(); }
+
+private:
+    static_assert(LIQUID_ASYNC_READY_SIZE >= LIQUID_ASYNC_FRAMES,
+                  "each frame needs room in the ready queue");
+
+    SysTimer  &clock;
+    AsyncWait *waiting {nullptr};
+
+    RingBuffer<std::coroutine_handle<>, LIQUID_ASYNC_READY_SIZE> ready;
+
+    auto hasWork() -> bool
+    {
+        if (!ready.isEmpty()) return true;
+        for (auto *w = waiting; w != nullptr; w = w->next) {
+            if (w->isReady(*w)) return true;
+        }
+        return false;
+    }
+};
+
+template <class P>
+auto PromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<P> h) noexcept -> void
+{
+    auto &promise = h.promise();
+    if (promise.continuation) {
+        promise.executor->post(promise.continuation);
+    } else if (promise.detached) {
+        h.destroy();
+    }
+}
+
+// Awaitables that park the coroutine on the executor until isReady() says so
+template <class Derived> struct AsyncWaitAwaiter : AsyncWait {
+    auto await_ready() -> bool { return false; }
+
+    template <class P> auto await_suspend(std::coroutine_handle<P> h) -> void
+    {
+        auto &executor = *h.promise().executor;
+        handle = h;
+        isReady = [](AsyncWait &w) { return static_cast<Derived &>(w).check(); };
+        static_cast<Derived &>(*this).start(executor);
+        executor.wait(*this);
+    }
+};
+
+/*
+ * co_await sleepFor(ticks), in ticks of the executor's SysTimer, i.e.
+ * milliseconds with a 1 kHz SysTimer. Resumes at the first wake-up after.
+ */
+struct SleepFor : AsyncWaitAwaiter<SleepFor> {
+    Executor     *executor {nullptr};
+    unsigned long ticks;
+    unsigned long startTime {0};
+
+    explicit SleepFor(unsigned long ticks_) : ticks(ticks_) {}
+
+    auto start(Executor &executor_) -> void
+    {
+        executor = &executor_;
+        startTime = executor_.getTime();
+    }
+
+    auto check() -> bool { return executor->getTime() - startTime >= ticks; }
+
+    auto await_resume() -> void {}
+};
+
+inline auto sleepFor(unsigned long ticks) -> SleepFor { return SleepFor {ticks}; }
+
+/*
+ * co_await until(predicate), for state changed by an interrupt that has no
+ * completion callback. The predicate is checked after each wake-up, possibly
+ * with the interrupts disabled, and may be called again once true.
+ */
+template <class Predicate> struct Until : AsyncWaitAwaiter<Until<Predicate>> {
+    Predicate predicate;
+
+    explicit Until(Predicate predicate_) : predicate(predicate_) {}
+
+    auto await_ready() -> bool { return predicate(); }
+    auto start(Executor &) -> void {}
+    auto check() -> bool { return predicate(); }
+    auto await_resume() -> void {}
+};
+
+template <class Predicate> auto until(Predicate predicate) -> Until<Predicate>
+{
+    return Until<Predicate> {predicate};
+}
+
+/*
+ * Awaitable reads on a UART, Usart or an AVR driver. The bytes come from the
+ * RX buffer, no frame is needed.
+ *
+ *     AsyncUart console {usart};
+ *     const int length = co_await console.readLine(line, sizeof(line));
+ */
+template <class Uart> class AsyncUart
+{
+public:
+    explicit AsyncUart(Uart &uart_) : uart(uart_) {}
+
+    struct LineAwaiter : AsyncWaitAwaiter<LineAwaiter> {
+        Uart    &uart;
+        uint8_t *line;
+        int      size;
+        int      length {0};
+        bool     complete {false};
+
+        LineAwaiter(Uart &uart_, uint8_t *line_, int size_) : uart(uart_), line(line_), size(size_)
+        {
+        }
+
+        // The line may already be buffered
+        auto await_ready() -> bool { return check(); }
+        auto start(Executor &) -> void {}
+
+        // Same as Uart::readLine(): up to CR or LF, the rest of a long line is dropped
+        auto check() -> bool
+        {
+            uint8_t ch;
+            while (!complete && uart.read(&ch, 1) == 1) {
+                if (ch == '\n' || ch == '\r') {
+                    if (size > 0) line[length] = 0;
+                    complete = true;
+                } else if (length < size - 1) {
+                    line[length++] = ch;
+                }
+            }
+            return complete;
+        }
+
+        auto await_resume() -> int { return length; }
+    };
+
+    struct ByteAwaiter : AsyncWaitAwaiter<ByteAwaiter> {
+        Uart   &uart;
+        uint8_t data {0};
+        bool    received {false};
+
+        explicit ByteAwaiter(Uart &uart_) : uart(uart_) {}
+
+        auto await_ready() -> bool { return check(); }
+        auto start(Executor &) -> void {}
+
+        auto check() -> bool
+        {
+            if (!received) received = uart.read(&data, 1) == 1;
+            return received;
+        }
+        auto await_resume() -> uint8_t { return data; }
+    };
+
+    auto rx() -> ByteAwaiter { return ByteAwaiter {uart}; }
+
+    auto readLine(uint8_t *line, int size) -> LineAwaiter { return {uart, line, size}; }
+
+private:
+    Uart &uart;
+};
+
+} // namespace liquid
+
+#endif
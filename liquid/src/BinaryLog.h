@@ -0,0 +1,198 @@
+#ifndef LIQUID_BINARY_LOG_H_
+#define LIQUID_BINARY_LOG_H_
+
+#include "FlashStr.h"
+#include "Format.h"
+#include "PacketLink.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// A whole frame (payload, CRC, COBS overhead and delimiter) should fit in the
+// TX buffer, so logging does not wait for the line
+#ifndef LIQUID_LOG_MAX_PAYLOAD
+#define LIQUID_LOG_MAX_PAYLOAD 24
+#endif
+
+namespace liquid
+{
+
+/*
+ * Argument type codes, as in Python's struct module. Strings are sent NUL
+ * terminated. Integers and floats are sent as in memory, little endian.
+ */
+template <class T> struct LogType {
+    static constexpr char code = T(-1) < T(0) ? "?bh?i???q"[sizeof(T)] : "?BH?I???Q"[sizeof(T)];
+};
+
+template <> struct LogType<bool> {
+    static constexpr char code = '?';
+};
+template <> struct LogType<char> {
+    static constexpr char code = 'c';
+};
+template <> struct LogType<float> {
+    static constexpr char code = 'f';
+};
+template <> struct LogType<double> {
+    static constexpr char code = sizeof(double) == sizeof(float) ? 'f' : 'd';
+};
+template <> struct LogType<const char *> {
+    static constexpr char code = 's';
+};
+template <> struct LogType<char *> {
+    static constexpr char code = 's';
+};
+template <size_t N> struct LogType<char[N]> {
+    static constexpr char code = 's';
+};
+template <> struct LogType<FlashStr> {
+    static constexpr char code = 's';
+};
+
+template <int N> struct LogRecord {
+    uint8_t bytes[N];
+};
+
+/*
+ * One log site, a format string and the argument types.
+ *
+ * The ID is a 16-bit FNV-1a hash of the types and the format string. It
+ * stays the same across builds as long as both do, so old tables keep
+ * decoding unchanged sites.
+ *
+ * The record is never read by the device, it is there for the host tool:
+ * magic, ID (little endian), type codes, NUL, format string, NUL.
+ */
+template <class Fmt, class... Args> struct LogSite {
+    static constexpr uint8_t magic[] = {0xA5, 'L', 'o', 'G'};
+    static constexpr char    types[] = {LogType<Args>::code..., 0};
+
+    static constexpr auto formatLength() -> int
+    {
+        int n = 0;
+        while (Fmt::get()[n] != 0)
+            ++n;
+        return n;
+    }
+
+    static constexpr auto hash() -> uint16_t
+    {
+        uint32_t h = 2166136261u;
+        for (int i = 0; i <= static_cast<int>(sizeof...(Args)); ++i)
+            h = (h ^ static_cast<uint8_t>(types[i])) * 16777619u;
+        for (int i = 0; i < formatLength(); ++i)
+            h = (h ^ static_cast<uint8_t>(Fmt::get()[i])) * 16777619u;
+        return static_cast<uint16_t>(h ^ (h >> 16));
+    }
+
+    static constexpr uint16_t id = hash();
+    static constexpr int      size =
+        sizeof(magic) + sizeof(id) + sizeof(types) + formatLength() + 1;
+
+    static constexpr auto makeRecord() -> LogRecord<size>
+    {
+        LogRecord<size> r {};
+        int             n = 0;
+        for (const auto b : magic)
+            r.bytes[n++] = b;
+        r.bytes[n++] = static_cast<uint8_t>(id);
+        r.bytes[n++] = static_cast<uint8_t>(id >> 8);
+        for (const auto c : types)
+            r.bytes[n++] = static_cast<uint8_t>(c);
+        for (int i = 0; i < formatLength(); ++i)
+            r.bytes[n++] = static_cast<uint8_t>(Fmt::get()[i]);
+        r.bytes[n] = 0;
+        return r;
+    }
+
+    static constexpr LogRecord<size> record FLASH_DATA __attribute__((used)) = makeRecord();
+};
+
+/*
+ * Deferred logging: the device sends the log site ID and the raw argument
+ * bytes, the host turns them back into text with tools/liquidlog.py.
+ *
+ *     PacketLink<Usart> link {console, rxBuffer, sizeof(rxBuffer)};
+ *     BinaryLog<Usart>  log {link};
+ *     log.write(FORMAT_STR("T={:.2} C after {} ms"), centiDegrees, time);
+ *
+ * Nothing is formatted on the device. A frame is the ID, little endian, then
+ * the arguments, in a PacketLink frame (COBS, CRC-16). The format string uses
+ * the format() syntax and is checked at compile time; the host does the
+ * formatting.
+ *
+ * The host table is built from the linked program, which holds a LogSite
+ * record for every site. liquid_log_table(target) in CMake does it after each
+ * link, next to the ELF file:
+ *
+ *     liquidlog.py table app.elf -o app.log.json
+ *     liquidlog.py decode app.log.json < /dev/ttyUSB0
+ */
+template <class Uart> class BinaryLog
+{
+public:
+    // Strings are cut to fit, frames never exceed this
+    static constexpr int maxPayload = LIQUID_LOG_MAX_PAYLOAD;
+
+    explicit BinaryLog(PacketLink<Uart> &link_) : link(link_) {}
+
+    template <class Fmt, class... Args> auto write(Fmt, const Args &...args) -> void
+    {
+        using Site = LogSite<Fmt, Args...>;
+
+        constexpr auto &program = FormatTraits<Fmt>::program;
+        static_assert(program.errorAt < 0, "malformed format string");
+        static_assert(program.fields == sizeof...(Args),
+                      "number of arguments does not match the format string");
+
+        // Keep the record in the program for the host tool
+        static_cast<void>(&Site::record);
+
+        uint8_t payload[maxPayload];
+        int     length = 0;
+        append(payload, length, Site::id);
+        (append(payload, length, args), ...);
+
+        link.post(payload, length);
+    }
+
+private:
+    PacketLink<Uart> &link;
+
+    template <class T> static auto append(uint8_t *payload, int &length, const T &value) -> void
+    {
+        if (length + static_cast<int>(sizeof(T)) > maxPayload) return;
+        memcpy(payload + length, &value, sizeof(T));
+        length += static_cast<int>(sizeof(T));
+    }
+
+    static auto append(uint8_t *payload, int &length, const char *str) -> void
+    {
+        while (*str != 0 && length < maxPayload - 1)
+            payload[length++] = static_cast<uint8_t>(*str++);
+        appendEnd(payload, length);
+    }
+
+    static auto append(uint8_t *payload, int &length, char *str) -> void
+    {
+        append(payload, length, static_cast<const char *>(str));
+    }
+
+    static auto append(uint8_t *payload, int &length, const FlashStr &str) -> void
+    {
+        for (size_t i = 0; str[i] != 0 && length < maxPayload - 1; ++i)
+            payload[length++] = static_cast<uint8_t>(str[i]);
+        appendEnd(payload, length);
+    }
+
+    static auto appendEnd(uint8_t *payload, int &length) -> void
+    {
+        if (length < maxPayload) payload[length++] = 0;
+    }
+};
+
+} // namespace liquid
+
+#endif
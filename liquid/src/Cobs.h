@@ -0,0 +1,194 @@
+#ifndef LIQUID_COBS_H_
+#define LIQUID_COBS_H_
+
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * Consistent Overhead Byte Stuffing. The encoded data contains no zeros,
+ * so a single 0x00 byte delimits frames.
+ */
+struct Cobs {
+    static constexpr uint8_t delimiter = 0;
+    static constexpr int     maxRun = 254;
+
+    static constexpr auto maxEncodedSize(int length) -> int
+    {
+        return length + length / maxRun + 1;
+    }
+
+    struct Segment {
+        const uint8_t *data;
+        int            length;
+    };
+
+    /*
+     * Encode the concatenation of the segments, without the trailing delimiter.
+     *
+     * The input is not copied: out.code(uint8_t) receives the overhead bytes and
+     * out.data(segment, data, length) the runs of input bytes between them, each
+     * pointing into the segment it came from.
+     */
+    template <class Out> static auto encode(const Segment *segments, int count, Out &out) -> void
+    {
+        int seg = 0;
+        int offset = 0;
+
+        const auto skipEmpty = [&]() {
+            while (seg < count && offset >= segments[seg].length) {
+                ++seg;
+                offset = 0;
+            }
+        };
+
+        while (true) {
+            // Find the run of non-zero bytes ahead, it may span several segments
+            int  run = 0;
+            bool hitZero = false;
+            int  s = seg;
+            int  o = offset;
+            while (run < maxRun && s < count) {
+                if (o >= segments[s].length) {
+                    ++s;
+                    o = 0;
+                    continue;
+                }
+                if (segments[s].data[o] == 0) {
+                    hitZero = true;
+                    break;
+                }
+                ++run;
+                ++o;
+            }
+
+            out.code(static_cast<uint8_t>(run + 1));
+
+            while (run > 0) {
+                skipEmpty();
+                const int left = segments[seg].length - offset;
+                const int n = run < left ? run : left;
+                out.data(seg, segments[seg].data + offset, n);
+                offset += n;
+                run -= n;
+            }
+
+            skipEmpty();
+            if (hitZero) {
+                ++offset;
+            } else if (seg >= count) {
+                break;
+            }
+        }
+    }
+
+    // Encode into a buffer of at least maxEncodedSize(length) bytes, returns the encoded size
+    static auto encode(const uint8_t *data, int length, uint8_t *encoded) -> int
+    {
+        struct BufferOut {
+            uint8_t *dst;
+
+            auto code(uint8_t c) -> void { *dst++ = c; }
+            auto data(int, const uint8_t *src, int n) -> void
+            {
+                for (int i = 0; i < n; ++i)
+                    *dst++ = src[i];
+            }
+        } out {encoded};
+
+        const Segment segment {data, length};
+        encode(&segment, 1, out);
+        return static_cast<int>(out.dst - encoded);
+    }
+};
+
+/*
+ * Incremental COBS decoder, fed one byte at a time (e.g. from the RX interrupt).
+ */
+class CobsDecoder
+{
+public:
+    enum class Status {
+        Busy,     // byte consumed, frame not complete
+        Frame,    // delimiter received, getLength() bytes decoded
+        Empty,    // delimiter without data, e.g. line idle filler
+        Overrun,  // frame larger than the buffer
+        Malformed // frame ended in the middle of a run
+    };
+
+    CobsDecoder(uint8_t *buffer_, int size_) : buffer(buffer_), size(size_) {}
+
+    auto feed(uint8_t byte) -> Status
+    {
+        if (byte == Cobs::delimiter) {
+            const auto status = finish();
+            endFrame();
+            return status;
+        }
+        if (overrun) return Status::Busy;
+
+        if (remaining == 0) {
+            if (!started) {
+                length = 0;
+                started = true;
+            }
+            if (pendingZero && !append(0)) return Status::Busy;
+            remaining = static_cast<uint8_t>(byte - 1);
+            pendingZero = byte != 0xFF;
+        } else {
+            append(byte);
+            --remaining;
+        }
+        return Status::Busy;
+    }
+
+    // The decoded frame, valid after Status::Frame until the next byte is fed
+    auto getLength() const -> int { return length; }
+    auto data() const -> const uint8_t * { return buffer; }
+
+    auto reset() -> void
+    {
+        endFrame();
+        length = 0;
+    }
+
+private:
+    uint8_t *buffer;
+    int      size;
+    int      length = 0;
+    uint8_t  remaining = 0;
+    bool     pendingZero = false;
+    bool     started = false;
+    bool     overrun = false;
+
+    auto append(uint8_t byte) -> bool
+    {
+        if (length >= size) {
+            overrun = true;
+            return false;
+        }
+        buffer[length++] = byte;
+        return true;
+    }
+
+    auto endFrame() -> void
+    {
+        remaining = 0;
+        pendingZero = false;
+        started = false;
+        overrun = false;
+    }
+
+    auto finish() const -> Status
+    {
+        if (!started) return Status::Empty;
+        if (overrun) return Status::Overrun;
+        if (remaining != 0) return Status::Malformed;
+        return Status::Frame;
+    }
+};
+
+} // namespace liquid
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef LIQUID_CRC16_H_
+#define LIQUID_CRC16_H_
+
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF, no reflection,
+ * no final XOR. Appending the CRC MSB first makes the CRC of the whole frame 0.
+ */
+struct Crc16 {
+    static constexpr uint16_t initial = 0xFFFF;
+
+    static constexpr auto update(uint16_t crc, uint8_t data) -> uint16_t
+    {
+        crc = static_cast<uint16_t>(crc ^ (data << 8));
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                                 : static_cast<uint16_t>(crc << 1);
+        }
+        return crc;
+    }
+
+    static constexpr auto compute(const uint8_t *data, int length, uint16_t crc = initial)
+        -> uint16_t
+    {
+        for (int i = 0; i < length; ++i)
+            crc = update(crc, data[i]);
+        return crc;
+    }
+};
+
+static_assert([] {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    return Crc16::compute(check, sizeof(check));
+}() == 0x29B1);
+
+} // namespace liquid
+
+#endif
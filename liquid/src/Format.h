@@ -0,0 +1,481 @@
+#ifndef LIQUID_FORMAT_H_
+#define LIQUID_FORMAT_H_
+
+#include "FlashStr.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace liquid
+{
+
+/*
+ * Type-safe formatting, a lightweight replacement for printf.
+ *
+ *     print(FORMAT_STR("t={} ms T={:.2} C id=0x{:04x}\r\n"), time, centiDegrees, id);
+ *
+ * The format string is parsed by the compiler into a fixed sequence of literal
+ * and field operations, nothing is parsed at run time. The literal text stays
+ * in program memory. The number of arguments and the field specs are checked
+ * at compile time.
+ *
+ * Fields are {} or {:[0][width][.precision][type]}, {{ and }} are literal braces.
+ * Types are d (decimal), x and X (hex), b (binary) and c (character). Numbers
+ * are right aligned in the width, padded with spaces or, with the 0 flag, zeros.
+ *
+ * There is no floating point. The precision prints an integer as fixed point
+ * with that many decimals: {:.2} prints 2345 as 23.45 and -5 as -0.05.
+ *
+ * Arguments are integers, char (a character unless a type is given), const char *
+ * and FlashStr. Other types can be added with a formatValue() overload found
+ * by argument dependent lookup.
+ *
+ * The output goes to a sink, any object with put(char): FormatBuffer, UartSink
+ * or StdioSink.
+ */
+struct FormatField {
+    enum class Type : uint8_t { Default, Decimal, Hex, HexUpper, Binary, Char };
+
+    uint8_t width = 0;
+    uint8_t precision = 0;
+    bool    zeroPad = false;
+    Type    type = Type::Default;
+};
+
+struct FormatOp {
+    bool        isField = false;
+    int         begin = 0; // Literal text, offset into the format string
+    int         length = 0;
+    FormatField field {};
+};
+
+template <int N> struct FormatProgram {
+    FormatOp ops[N > 0 ? N : 1] {};
+    int      count = 0;
+    int      fields = 0;
+    int      errorAt = -1; // Offset of the first malformed field, -1 if valid
+};
+
+struct FormatParser {
+    static constexpr int maxWidth = 32;
+
+    // Ops beyond N are counted but not stored, parse<0>() sizes the program
+    template <int N> static constexpr auto parse(const char *s) -> FormatProgram<N>
+    {
+        FormatProgram<N> p {};
+        int              i = 0;
+        int              literal = 0;
+
+        while (s[i] != 0) {
+            const char c = s[i];
+
+            if ((c == '{' || c == '}') && s[i + 1] == c) {
+                add(p, literal, i + 1);
+                i += 2;
+                literal = i;
+            } else if (c == '}') {
+                p.errorAt = i;
+                return p;
+            } else if (c == '{') {
+                add(p, literal, i);
+                const int start = i;
+
+                FormatField field {};
+                ++i;
+                if (s[i] == ':') {
+                    ++i;
+                    if (s[i] == '0') {
+                        field.zeroPad = true;
+                        ++i;
+                    }
+                    int width = 0;
+                    while (isDigit(s[i]) && width <= maxWidth)
+                        width = width * 10 + (s[i++] - '0');
+                    int precision = 0;
+                    if (s[i] == '.') {
+                        ++i;
+                        if (!isDigit(s[i])) precision = maxWidth + 1;
+                        while (isDigit(s[i]) && precision <= maxWidth)
+                            precision = precision * 10 + (s[i++] - '0');
+                    }
+                    if (width > maxWidth || precision > maxWidth) {
+                        p.errorAt = start;
+                        return p;
+                    }
+                    field.width = static_cast<uint8_t>(width);
+                    field.precision = static_cast<uint8_t>(precision);
+                    field.type = parseType(s[i]);
+                    if (field.type != FormatField::Type::Default) ++i;
+                }
+
+                const bool isDecimal = field.type == FormatField::Type::Default ||
+                                       field.type == FormatField::Type::Decimal;
+                if (s[i] != '}' || (field.precision > 0 && !isDecimal)) {
+                    p.errorAt = start;
+                    return p;
+                }
+                ++i;
+
+                if (p.count < N) p.ops[p.count] = {true, 0, 0, field};
+                ++p.count;
+                ++p.fields;
+                literal = i;
+            } else {
+                ++i;
+            }
+        }
+        add(p, literal, i);
+        return p;
+    }
+
+private:
+    static constexpr auto isDigit(char c) -> bool { return c >= '0' && c <= '9'; }
+
+    static constexpr auto parseType(char c) -> FormatField::Type
+    {
+        switch (c) {
+        case 'd': return FormatField::Type::Decimal;
+        case 'x': return FormatField::Type::Hex;
+        case 'X': return FormatField::Type::HexUpper;
+        case 'b': return FormatField::Type::Binary;
+        case 'c': return FormatField::Type::Char;
+        default: return FormatField::Type::Default;
+        }
+    }
+
+    template <int N> static constexpr auto add(FormatProgram<N> &p, int begin, int end) -> void
+    {
+        if (end <= begin) return;
+        if (p.count < N) p.ops[p.count] = {false, begin, end - begin, {}};
+        ++p.count;
+    }
+};
+
+// The compiled program of a FORMAT_STR type
+template <class Fmt> struct FormatTraits {
+    static constexpr auto program =
+        FormatParser::parse<FormatParser::parse<0>(Fmt::get()).count>(Fmt::get());
+};
+
+template <int size> struct FormatUnsigned;
+template <> struct FormatUnsigned<1> {
+    using Type = uint8_t;
+};
+template <> struct FormatUnsigned<2> {
+    using Type = uint16_t;
+};
+template <> struct FormatUnsigned<4> {
+    using Type = uint32_t;
+};
+template <> struct FormatUnsigned<8> {
+    using Type = uint64_t;
+};
+
+// Conversions used by the formatValue() overloads
+struct Format {
+    template <class Sink> static auto pad(Sink &sink, char fill, int count) -> void
+    {
+        for (; count > 0; --count)
+            sink.put(fill);
+    }
+
+    template <class Sink> static auto writeFlash(Sink &sink, const char *str, int length) -> void
+    {
+        const FlashStr flash {str};
+        for (int i = 0; i < length; ++i)
+            sink.put(flash[static_cast<size_t>(i)]);
+    }
+
+    /*
+     * Digits are produced with the value's own width, so 8 and 16-bit values
+     * never go through the 32-bit division routines. Hex and binary only shift.
+     */
+    template <class Sink, class U>
+    static auto writeUnsigned(Sink &sink, U value, bool negative, FormatField field) -> void
+    {
+        if (field.type == FormatField::Type::Char) {
+            pad(sink, ' ', field.width - 1);
+            sink.put(static_cast<char>(value));
+            return;
+        }
+
+        char digits[sizeof(U) * 8]; // Least significant first
+        int  count = 0;
+
+        switch (field.type) {
+        case FormatField::Type::Hex:
+        case FormatField::Type::HexUpper: {
+            const char alpha = field.type == FormatField::Type::Hex ? 'a' : 'A';
+            do {
+                const auto nibble = static_cast<uint8_t>(value & 0x0F);
+                digits[count++] =
+                    static_cast<char>(nibble < 10 ? '0' + nibble : alpha + nibble - 10);
+                value = static_cast<U>(value >> 4);
+            } while (value != 0);
+            break;
+        }
+        case FormatField::Type::Binary:
+            do {
+                digits[count++] = static_cast<char>('0' + (value & 1));
+                value = static_cast<U>(value >> 1);
+            } while (value != 0);
+            break;
+        default:
+            do {
+                digits[count++] = static_cast<char>('0' + value % 10);
+                value = static_cast<U>(value / 10);
+            } while (value != 0);
+            break;
+        }
+
+        // The last precision digits are the fraction
+        const int precision = field.precision;
+        const int intDigits = count > precision ? count - precision : 1;
+        const int length = negative + intDigits + (precision > 0 ? precision + 1 : 0);
+
+        if (!field.zeroPad) pad(sink, ' ', field.width - length);
+        if (negative) sink.put('-');
+        if (field.zeroPad) pad(sink, '0', field.width - length);
+
+        if (count <= precision) sink.put('0');
+        for (int i = count - 1; i >= precision; --i)
+            sink.put(digits[i]);
+
+        if (precision > 0) {
+            sink.put('.');
+            pad(sink, '0', precision - count);
+            for (int i = (count < precision ? count : precision) - 1; i >= 0; --i)
+                sink.put(digits[i]);
+        }
+    }
+
+    // Hex and binary print the two's complement, like printf
+    template <class Sink, class T> static auto writeSigned(Sink &sink, T value, FormatField field)
+    {
+        using U = typename FormatUnsigned<sizeof(T)>::Type;
+
+        const bool negative = value < 0 && (field.type == FormatField::Type::Default ||
+                                            field.type == FormatField::Type::Decimal);
+        const auto magnitude = negative ? static_cast<U>(0u - static_cast<U>(value))
+                                        : static_cast<U>(value);
+        writeUnsigned(sink, magnitude, negative, field);
+    }
+
+    template <class Sink, class T> static auto writeUnsigned(Sink &sink, T value, FormatField field)
+    {
+        using U = typename FormatUnsigned<sizeof(T)>::Type;
+        writeUnsigned(sink, static_cast<U>(value), false, field);
+    }
+
+    template <class Sink> static auto writeString(Sink &sink, const char *str, FormatField field)
+    {
+        if (field.width > 0) pad(sink, ' ', field.width - static_cast<int>(strlen(str)));
+        while (*str != 0)
+            sink.put(*str++);
+    }
+
+    template <class Sink>
+    static auto writeString(Sink &sink, const FlashStr &str, FormatField field) -> void
+    {
+        if (field.width > 0) pad(sink, ' ', field.width - static_cast<int>(str.length()));
+        for (size_t i = 0; str[i] != 0; ++i)
+            sink.put(str[i]);
+    }
+};
+
+template <class Sink> auto formatValue(Sink &sink, char value, FormatField field) -> void
+{
+    if (field.type == FormatField::Type::Default) field.type = FormatField::Type::Char;
+    Format::writeSigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, bool value, FormatField field) -> void
+{
+    Format::writeUnsigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, signed char value, FormatField field) -> void
+{
+    Format::writeSigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, unsigned char value, FormatField field) -> void
+{
+    Format::writeUnsigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, short value, FormatField field) -> void
+{
+    Format::writeSigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, unsigned short value, FormatField field) -> void
+{
+    Format::writeUnsigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, int value, FormatField field) -> void
+{
+    Format::writeSigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, unsigned int value, FormatField field) -> void
+{
+    Format::writeUnsigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, long value, FormatField field) -> void
+{
+    Format::writeSigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, unsigned long value, FormatField field) -> void
+{
+    Format::writeUnsigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, long long value, FormatField field) -> void
+{
+    Format::writeSigned(sink, value, field);
+}
+
+template <class Sink>
+auto formatValue(Sink &sink, unsigned long long value, FormatField field) -> void
+{
+    Format::writeUnsigned(sink, value, field);
+}
+
+template <class Sink> auto formatValue(Sink &sink, const char *value, FormatField field) -> void
+{
+    Format::writeString(sink, value, field);
+}
+
+template <class Sink>
+auto formatValue(Sink &sink, const FlashStr &value, FormatField field) -> void
+{
+    Format::writeString(sink, value, field);
+}
+
+// Runs the ops from op on, each field takes the next argument
+template <class Fmt, int op, class Sink> auto formatOps(Sink &sink) -> void
+{
+    constexpr auto &program = FormatTraits<Fmt>::program;
+
+    if constexpr (op < program.count) {
+        constexpr auto current = program.ops[op];
+        Format::writeFlash(sink, Fmt::flash() + current.begin, current.length);
+        formatOps<Fmt, op + 1>(sink);
+    }
+}
+
+template <class Fmt, int op, class Sink, class Arg, class... Rest>
+auto formatOps(Sink &sink, const Arg &arg, const Rest &...rest) -> void
+{
+    constexpr auto &program = FormatTraits<Fmt>::program;
+
+    if constexpr (op < program.count) {
+        constexpr auto current = program.ops[op];
+        if constexpr (current.isField) {
+            formatValue(sink, arg, current.field);
+            formatOps<Fmt, op + 1>(sink, rest...);
+        } else {
+            Format::writeFlash(sink, Fmt::flash() + current.begin, current.length);
+            formatOps<Fmt, op + 1>(sink, arg, rest...);
+        }
+    }
+}
+
+template <class Sink, class Fmt, class... Args>
+auto format(Sink &sink, Fmt, const Args &...args) -> void
+{
+    constexpr auto &program = FormatTraits<Fmt>::program;
+    static_assert(program.errorAt < 0, "malformed format string");
+    static_assert(program.fields == sizeof...(Args),
+                  "number of arguments does not match the format string");
+
+    formatOps<Fmt, 0>(sink, args...);
+}
+
+// Writes into a char buffer, always NUL terminated. Output beyond the size is dropped.
+class FormatBuffer
+{
+public:
+    FormatBuffer(char *buffer_, int size_) : buffer(buffer_), size(size_) { buffer[0] = 0; }
+
+    auto put(char ch) -> void
+    {
+        if (length < size - 1) {
+            buffer[length++] = ch;
+            buffer[length] = 0;
+        } else {
+            truncated = true;
+        }
+    }
+
+    auto str() const -> const char * { return buffer; }
+    auto getLength() const -> int { return length; }
+    auto isTruncated() const -> bool { return truncated; }
+
+    auto clear() -> void
+    {
+        length = 0;
+        buffer[0] = 0;
+        truncated = false;
+    }
+
+private:
+    char *buffer;
+    int   size;
+    int   length = 0;
+    bool  truncated = false;
+};
+
+// Writes into the UART's TX buffer, e.g. UartSink out {console}
+template <class Uart> class UartSink
+{
+public:
+    explicit UartSink(Uart &uart_) : uart(uart_) {}
+
+    auto put(char ch) -> void { uart.tx(static_cast<uint8_t>(ch)); }
+
+private:
+    Uart &uart;
+};
+
+// Writes to stdout, keeping the order with printf output
+struct StdioSink {
+    auto put(char ch) -> void { putchar(ch); }
+};
+
+// Like snprintf, returns the formatted length, without the output that did not fit
+template <class Fmt, class... Args>
+auto formatTo(char *buffer, int size, Fmt fmt, const Args &...args) -> int
+{
+    FormatBuffer sink(buffer, size);
+    format(sink, fmt, args...);
+    return sink.getLength();
+}
+
+template <class Fmt, class... Args> auto print(Fmt fmt, const Args &...args) -> void
+{
+    StdioSink sink;
+    format(sink, fmt, args...);
+}
+
+} // namespace liquid
+
+/*
+ * Format string for format(). The string is parsed at compile time and only
+ * the literal text is kept, in program memory.
+ */
+#define FORMAT_STR(s)                                                                              \
+    ([] {                                                                                          \
+        struct FormatString {                                                                      \
+            static constexpr auto get() -> const char * { return s; }                              \
+            static auto flash() -> const char * { return FLASH_STR(s).get(); }                     \
+        };                                                                                         \
+        return FormatString {};                                                                    \
+    }())
+
+#endif
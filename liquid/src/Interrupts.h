@@ -29,9 +29,6 @@ struct IrqHandler
     }
 };
 
-auto addUsartIsr(IrqFunc func, void *data) -> void;
-auto callUsartIsr() -> void;
-
 constexpr auto isValidIrq(int irq) -> bool
 {
     return irq != InvalidIrq;
@@ -0,0 +1,145 @@
+#ifndef LIQUID_LINE_ASSEMBLER_H_
+#define LIQUID_LINE_ASSEMBLER_H_
+
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * Collects received characters into a line, one character at a time.
+ *
+ * Lines end with CR, LF or CRLF. Backspace (BS or DEL) removes the last character.
+ * Characters beyond the buffer size are dropped, the line is always NUL terminated.
+ *
+ * Feed it from the RX interrupt (Usart::setRxHandler(LineAssembler::rxFunc, &line))
+ * or from the main loop with poll(). A complete line goes to the line handler,
+ * or, without one, is held until the next poll() or release(). Characters fed
+ * while a line is held are dropped.
+ */
+class LineAssembler
+{
+public:
+    using CharFunc = auto (*)(void *data, uint8_t ch) -> void;
+    using LineFunc = auto (*)(void *data, const char *line, int length) -> void;
+
+    LineAssembler(char *buffer_, int size_) : buffer(buffer_), size(size_) { buffer[0] = 0; }
+
+    // Characters to send back to the terminal, e.g. Usart::tx(). When fed from
+    // the RX interrupt, the UART must not use OverflowPolicy::Block.
+    auto setEcho(CharFunc func, void *data) -> void
+    {
+        echoFunc = func;
+        echoData = data;
+    }
+
+    template <class Uart> auto setEcho(Uart &uart) -> void
+    {
+        setEcho([](void *u, uint8_t ch) { static_cast<Uart *>(u)->tx(ch); }, &uart);
+    }
+
+    // Called for each complete line, from the context that feeds the characters.
+    // The line is released when the handler returns.
+    auto setLineHandler(LineFunc func, void *data) -> void
+    {
+        lineFunc = func;
+        lineData = data;
+    }
+
+    // Returns true when ch completed a line
+    auto feed(uint8_t ch) -> bool
+    {
+        if (ready) return false;
+
+        const bool afterCr = lastWasCr;
+        lastWasCr = ch == '\r';
+
+        switch (ch) {
+        case '\n':
+            if (afterCr) return false;
+            return completeLine();
+        case '\r': return completeLine();
+        case 0x08:
+        case 0x7F:
+            if (length > 0) {
+                buffer[--length] = 0;
+                echo('\b');
+                echo(' ');
+                echo('\b');
+            }
+            return false;
+        default:
+            if (length < size - 1) {
+                buffer[length++] = static_cast<char>(ch);
+                buffer[length] = 0;
+                echo(ch);
+            }
+            return false;
+        }
+    }
+
+    // Adapter for Usart::setRxHandler()
+    static auto rxFunc(void *self, uint8_t ch) -> void
+    {
+        static_cast<LineAssembler *>(self)->feed(ch);
+    }
+
+    // Feed whatever the UART has received so far. Returns the line once it is
+    // complete, nullptr otherwise. The returned line stays valid until the next call.
+    template <class Uart> auto poll(Uart &uart) -> const char *
+    {
+        if (ready) release();
+
+        while (uart.isRxReady()) {
+            if (feed(uart.rx()) && ready) return buffer;
+        }
+        return nullptr;
+    }
+
+    auto isLineReady() const -> bool { return ready; }
+    auto line() const -> const char * { return buffer; }
+    auto getLength() const -> int { return length; }
+
+    // Start collecting the next line
+    auto release() -> void
+    {
+        length = 0;
+        buffer[0] = 0;
+        ready = false;
+    }
+
+private:
+    char *buffer;
+    int   size;
+    int   length = 0;
+
+    volatile bool ready = false;
+    bool          lastWasCr = false;
+
+    CharFunc echoFunc = nullptr;
+    void    *echoData = nullptr;
+    LineFunc lineFunc = nullptr;
+    void    *lineData = nullptr;
+
+    auto echo(uint8_t ch) -> void
+    {
+        if (echoFunc != nullptr) echoFunc(echoData, ch);
+    }
+
+    auto completeLine() -> bool
+    {
+        echo('\r');
+        echo('\n');
+
+        ready = true;
+        if (lineFunc != nullptr) {
+            lineFunc(lineData, buffer, length);
+            release();
+        }
+        return true;
+    }
+};
+
+} // namespace liquid
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef LIQUID_PACKET_LINK_H_
+#define LIQUID_PACKET_LINK_H_
+
+#include "Cobs.h"
+#include "Crc16.h"
+#include "Interrupts.h"
+#include "Uart.h"
+
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * Framed packets over a UART: payload + CRC-16 (MSB first), COBS encoded,
+ * terminated with a 0x00 delimiter.
+ *
+ * Uart is Usart or one of the AVR drivers. Sending queues the payload by
+ * reference, only the COBS overhead, the CRC and short runs are copied to the
+ * TX buffer. Those copies always wait for room: the UART's overflow policy
+ * would drop or discard bytes of the frame and corrupt it.
+ *
+ * Receiving decodes in the RX interrupt once attach() was called. A checked
+ * frame goes to the frame handler or is held until release().
+ */
+template <class Uart> class PacketLink
+{
+public:
+    using FrameFunc = auto (*)(void *data, const uint8_t *payload, int length) -> void;
+
+    static constexpr int crcSize = 2;
+
+    // Shorter runs of payload bytes are copied to the TX buffer, saving TX queue entries
+    static constexpr int minZeroCopyRun = 4;
+
+    // rxBuffer holds one decoded frame, payload + CRC
+    PacketLink(Uart &uart_, uint8_t *rxBuffer, int rxSize) : uart(uart_), decoder(rxBuffer, rxSize)
+    {
+    }
+
+    // Route received bytes through the frame decoder
+    auto attach() -> void { uart.setRxHandler(rxFunc, this); }
+
+    // Called from the RX interrupt for each checked frame, which is released
+    // when the handler returns
+    auto setFrameHandler(FrameFunc func, void *data) -> void
+    {
+        frameFunc = func;
+        frameData = data;
+    }
+
+    // The payload is not copied, it must stay valid until onComplete is called
+    auto send(const void *payload, int length, const IrqHandler &onComplete) -> void
+    {
+        encodeFrame(static_cast<const uint8_t *>(payload), length, minZeroCopyRun);
+
+        // Requests complete in order, so onComplete runs after the whole payload was sent
+        uart.tx(&frameEnd, 1, onComplete);
+    }
+
+    // Copies the whole frame to the TX buffer and returns without waiting, for
+    // short payloads built on the stack
+    auto post(const void *payload, int length) -> void
+    {
+        encodeFrame(static_cast<const uint8_t *>(payload), length, noZeroCopy);
+        uart.tx(frameEnd, block);
+    }
+
+    // Returns when the payload is no longer needed
+    auto send(const void *payload, int length) -> void
+    {
+        send(payload, length, {nullptr, nullptr});
+        uart.flush();
+    }
+
+    // Feed one received byte, normally done by the RX interrupt
+    auto receive(uint8_t byte) -> void
+    {
+        if (ready || syncing) {
+            // Drop the rest of a frame that arrived while the previous one was held
+            if (byte == Cobs::delimiter) {
+                if (syncing) ++lostFrames;
+                syncing = false;
+            } else {
+                syncing = true;
+            }
+            return;
+        }
+
+        switch (decoder.feed(byte)) {
+        case CobsDecoder::Status::Busy:
+        case CobsDecoder::Status::Empty: break;
+        case CobsDecoder::Status::Overrun:
+        case CobsDecoder::Status::Malformed: ++badFrames; break;
+        case CobsDecoder::Status::Frame: checkFrame(); break;
+        }
+    }
+
+    static auto rxFunc(void *self, uint8_t byte) -> void
+    {
+        static_cast<PacketLink *>(self)->receive(byte);
+    }
+
+    auto isFrameReady() const -> bool { return ready; }
+    auto payload() const -> const uint8_t * { return decoder.data(); }
+    auto getLength() const -> int { return decoder.getLength() - crcSize; }
+
+    // Start receiving the next frame
+    auto release() -> void { ready = false; }
+
+    // Frames failing the CRC or COBS checks, or too large for the buffer
+    auto getBadFrames() const -> unsigned int { return badFrames; }
+
+    // Frames dropped because the previous one was not released yet
+    auto getLostFrames() const -> unsigned int { return lostFrames; }
+
+private:
+    static constexpr uint8_t frameEnd = Cobs::delimiter;
+    static constexpr int     noZeroCopy = Cobs::maxRun + 1;
+    static constexpr auto    block = Usart::OverflowPolicy::Block;
+
+    struct TxOut {
+        Uart &uart;
+        int   zeroCopyRun;
+
+        auto code(uint8_t c) -> void { uart.tx(c, block); }
+
+        auto data(int segment, const uint8_t *run, int length) -> void
+        {
+            // Only the payload outlives send(), the CRC is on the stack
+            if (segment == 0 && length >= zeroCopyRun) {
+                uart.tx(run, length);
+                return;
+            }
+            for (int i = 0; i < length; ++i)
+                uart.tx(run[i], block);
+        }
+    };
+
+    Uart       &uart;
+    CobsDecoder decoder;
+
+    volatile bool ready = false;
+    bool          syncing = false;
+    FrameFunc     frameFunc = nullptr;
+    void         *frameData = nullptr;
+    unsigned int  badFrames = 0;
+    unsigned int  lostFrames = 0;
+
+    // Everything but the delimiter
+    auto encodeFrame(const uint8_t *data, int length, int zeroCopyRun) -> void
+    {
+        const auto    crc = Crc16::compute(data, length);
+        const uint8_t crcBytes[crcSize] = {static_cast<uint8_t>(crc >> 8),
+                                           static_cast<uint8_t>(crc)};
+        const Cobs::Segment segments[] = {{data, length}, {crcBytes, crcSize}};
+
+        TxOut out {uart, zeroCopyRun};
+        Cobs::encode(segments, 2, out);
+    }
+
+    auto checkFrame() -> void
+    {
+        const auto length = decoder.getLength();
+        if (length < crcSize || Crc16::compute(decoder.data(), length) != 0) {
+            ++badFrames;
+            return;
+        }
+
+        ready = true;
+        if (frameFunc != nullptr) {
+            frameFunc(frameData, payload(), getLength());
+            release();
+        }
+    }
+};
+
+} // namespace liquid
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef LIQUID_RING_BUFFER_H_
+#define LIQUID_RING_BUFFER_H_
+
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * Lock-free single-producer / single-consumer FIFO.
+ *
+ * One context (e.g. an ISR) only pushes, the other one only pops. Head and tail
+ * are free running 8-bit indices, so each of them is updated with a single store
+ * and neither side has to disable interrupts.
+ */
+template <class T, uint8_t N> class RingBuffer
+{
+    static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0,
+                  "RingBuffer size must be a power of 2, not larger than 128");
+
+public:
+    static constexpr uint8_t capacity = N;
+
+    // Producer side
+
+    auto push(const T &item) -> bool
+    {
+        const uint8_t h = head;
+        if (static_cast<uint8_t>(h - tail) == N) return false;
+
+        data[h & mask] = item;
+        barrier();
+        head = static_cast<uint8_t>(h + 1);
+        return true;
+    }
+
+    // Newest item, for in-place updates. The consumer must not run concurrently,
+    // i.e. call it with interrupts disabled when the consumer is an ISR.
+    auto back() -> T *
+    {
+        return isEmpty() ? nullptr : &data[static_cast<uint8_t>(head - 1) & mask];
+    }
+
+    // Consumer side
+
+    auto pop(T &item) -> bool
+    {
+        const uint8_t t = tail;
+        if (t == head) return false;
+
+        item = data[t & mask];
+        barrier();
+        tail = static_cast<uint8_t>(t + 1);
+        return true;
+    }
+
+    auto peek(T &item, uint8_t offset = 0) const -> bool
+    {
+        const uint8_t t = tail;
+        if (offset >= static_cast<uint8_t>(head - t)) return false;
+
+        item = data[static_cast<uint8_t>(t + offset) & mask];
+        return true;
+    }
+
+    // In-place access to queued items, starting from the oldest one.
+    // Release the oldest item with drop().
+    auto at(uint8_t offset) -> T *
+    {
+        const uint8_t t = tail;
+        if (offset >= static_cast<uint8_t>(head - t)) return nullptr;
+
+        return &data[static_cast<uint8_t>(t + offset) & mask];
+    }
+
+    auto front() -> T * { return at(0); }
+
+    auto drop() -> void
+    {
+        barrier();
+        if (!isEmpty()) tail = static_cast<uint8_t>(tail + 1);
+    }
+
+    auto clear() -> void { tail = head; }
+
+    // Either side
+
+    auto size() const -> uint8_t { return static_cast<uint8_t>(head - tail); }
+    auto isEmpty() const -> bool { return head == tail; }
+    auto isFull() const -> bool { return size() == N; }
+
+private:
+    static constexpr uint8_t mask = N - 1;
+
+    T                data[N] {};
+    volatile uint8_t head {0};
+    volatile uint8_t tail {0};
+
+    // Keep the compiler from moving the data access past the index update
+    static inline auto barrier() -> void { __asm__ __volatile__("" ::: "memory"); }
+};
+
+} // namespace liquid
+
+#endif
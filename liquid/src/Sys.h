@@ -7,11 +7,46 @@ namespace liquid
 class Sys
 {
 public:
+    // Values of the SM bits
+    enum class SleepMode {
+        Idle = 0,
+        AdcNoiseReduction = 1, // Also stops clkIO: timers 0 and 1, USART, SPI and TWI pause
+    };
+
     static unsigned int getFreeMemory();
 
     static auto enableInterrupts() -> void;
     static auto disableInterrupts() -> void;
     static auto areInterruptsEnabled() -> bool;
+
+    // Call with the interrupts disabled. Enables them and sleeps until the next one.
+    static auto sleepWithInterrupts(SleepMode mode) -> void;
+
+    /*
+     * Sleep until done() returns true, checking it after each interrupt, which
+     * returns with the interrupts enabled. done() runs with them disabled, so an
+     * interrupt can't slip in between the check and the sleep: it wakes the CPU
+     * right away, sei takes effect after the sleep instruction.
+     *
+     * done() must become true from an interrupt. With the interrupts disabled
+     * there is nothing to wake up for, it spins instead.
+     */
+    template <class Done>
+    static auto waitUntil(Done done, SleepMode mode = SleepMode::Idle) -> void
+    {
+        if (!areInterruptsEnabled()) {
+            while (!done())
+                ;
+            return;
+        }
+
+        while (true) {
+            disableInterrupts();
+            if (done()) break;
+            sleepWithInterrupts(mode);
+        }
+        enableInterrupts();
+    }
 };
 
 class NoInterruptsGuard
@@ -20,12 +20,11 @@ public:
         timer.apply(cfg);
     }
 
+    // Keeps the interrupt state, can be called from a Sys::waitUntil() check
     inline auto getTime() -> unsigned long
     {
-        Sys::disableInterrupts();
-        auto t = sysTime;
-        Sys::enableInterrupts();
-        return t;
+        NoInterruptsGuard guard;
+        return sysTime;
     }
 
     inline auto isr() { ++sysTime; }
@@ -13,6 +13,9 @@ public:
 
     virtual auto enablePeriodicInterrupt(unsigned long fCpu, float freq, const IrqHandler &handler) -> bool = 0;
     virtual auto disablePeriodicInterrupt() -> void = 0;
+
+    // Start a full period from now, with the interrupt enabled. Cheap enough for an ISR.
+    virtual auto restartPeriodicInterrupt() -> void = 0;
     virtual auto stop() -> void = 0;
 };
 
@@ -1,15 +1,21 @@
 #ifndef LIQUID_UART_H_
 #define LIQUID_UART_H_
 
+#include "Interrupts.h"
+
 #include <stdint.h>
 
 namespace liquid
 {
 
+class Gpio;
+class Timer;
+
 class Usart
 {
 public:
     class Impl;
+    struct BaudConfig;
 
     struct ParityMode {
         static constexpr auto DISABLED = 0;
@@ -30,13 +36,69 @@ public:
         static constexpr auto SIZE_9_BIT = 7;
     };
 
-    auto setBaud(unsigned long fCpu, unsigned long baud) -> void;
-    auto setupUart(unsigned long fCpu, unsigned long baud) -> void;
+    // What tx(uint8_t) does when the TX buffer is full
+    enum class OverflowPolicy {
+        Block,           // wait for the interrupt to make room
+        Drop,            // discard the new byte
+        OverwriteOldest, // discard the oldest byte not sent yet
+    };
+
+    // Traffic and error counters, see getStats()
+    struct Stats {
+        unsigned long bytesSent;
+        unsigned long bytesReceived;
+        unsigned int  overruns;      // DOR, the hardware lost bytes before rxIsr() ran
+        unsigned int  framingErrors; // FE
+        unsigned int  parityErrors;  // UPE
+        unsigned int  rxDropped;     // received while the RX buffer was full
+        uint8_t       rxHighWater;   // peak RX buffer fill level
+        uint8_t       txHighWater;   // peak TX buffer fill level
+        unsigned long rxIsrCount;
+        unsigned long udreIsrCount;
+        unsigned long txIsrCount;
+    };
+
+    // No broadcast address in multiprocessor mode
+    static constexpr int noBroadcast = -1;
+
+    // Receives bytes in the RX interrupt context
+    using RxFunc = auto (*)(void *data, uint8_t byte) -> void;
+
+    // These return false, without changing the settings, for an invalid baud rate
+    auto setBaud(unsigned long fCpu, unsigned long baud) -> bool;
+    auto setupUart(unsigned long fCpu, unsigned long baud) -> bool;
+    auto setupUart(const BaudConfig &config) -> bool;
+    auto apply(const BaudConfig &config) -> bool;
     auto tx(uint8_t data) -> void;
+    auto tx(uint8_t data, OverflowPolicy policy) -> void;
     auto tx(const void *data, int length) -> void;
+    auto tx(const void *data, int length, const IrqHandler &onComplete) -> void;
+    auto flush() -> void;
+    auto setOverflowPolicy(OverflowPolicy policy) -> void;
+    auto getDroppedBytes() const -> unsigned int;
+    auto getStats() const -> Stats;
+    auto resetStats() -> void;
     auto isRxReady() const -> bool;
     auto rx() -> uint8_t;
+    auto available() const -> int;
+    auto read(void *data, int length) -> int;
+    auto peek() const -> int;
     auto readLine(uint8_t *rxbuf, int size) -> int;
+    auto setRxHandler(RxFunc func, void *data) -> void;
+    auto enableMultiprocessorMode(uint8_t address, int broadcast = noBroadcast) -> void;
+    auto enableMultiprocessorMode() -> void;
+    auto disableMultiprocessorMode() -> void;
+    auto sendAddress(uint8_t address) -> void;
+    auto isAddressed() const -> bool;
+    auto enableRs485(Gpio &driverEnable) -> void;
+    auto enableRs485(Gpio &driverEnable, Timer &timer, unsigned long fCpu, float guardTime)
+        -> bool;
+    auto disableRs485() -> void;
+    auto enableFlowControl(Gpio &rts, Gpio &cts) -> void;
+    auto disableFlowControl() -> void;
+
+    // The platform driver, for what the facade does not cover, e.g. tx(FlashStr)
+    auto getImpl() -> Impl & { return *impl; }
 
     Usart(Impl *impl_) : impl(impl_) {}
     Usart(Usart &&other) = default;
@@ -49,7 +111,13 @@ private:
     Usart &operator=(const Usart &) = delete;
 };
 
-void installAsStdStreams(Usart &uart);
+// Route stdio through the UART. Output is buffered and sent by the interrupt,
+// the policy decides what happens when printing faster than the line rate.
+void installAsStdStreams(Usart &uart,
+                         Usart::OverflowPolicy policy = Usart::OverflowPolicy::Block);
+
+// Wait until all buffered stdio output has been handed to the hardware
+void flushStdStreams();
 
 } // namespace liquid
 
@@ -0,0 +1,259 @@
+#ifndef LIQUID_AHT20_H_
+#define LIQUID_AHT20_H_
+
+#include "../Sys.h"
+#include "../SysTimer.h"
+#include "../util.h"
+#include "AvrI2c.h"
+
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * AHT20 (and AHT10/AHT21) humidity and temperature sensor, sampled
+ * periodically without blocking:
+ *
+ *     initialize -> trigger -> wait for the conversion -> read -> convert
+ *
+ * The transactions are queued on the controller and complete in the
+ * interrupt. poll(), from the main loop, runs the timed steps and the
+ * measurement callback. Several sensors on one bus sample concurrently,
+ * each one only uses the bus for its own transactions.
+ *
+ * Times are in ticks of the SysTimer, which must run at 1 kHz.
+ *
+ *     Aht20 sensor {bus, sysTimer};
+ *     sensor.onMeasurement(print, nullptr);
+ *     sensor.start(2000);
+ *     while (true) {
+ *         sensor.poll();
+ *         ...
+ *     }
+ */
+class Aht20
+{
+public:
+    using Status = AvrI2c::Status;
+
+    static constexpr uint8_t defaultAddress = 0x38;
+
+    // After the initialize command, for the calibration to load
+    static constexpr unsigned long initTime = 10;
+    // Typical conversion time. Still busy then, the status is read again after retryTime.
+    static constexpr unsigned long conversionTime = 80;
+    static constexpr unsigned long retryTime = 10;
+
+    struct Measurement {
+        int16_t  temperature; // Hundredths of a degree Celsius
+        uint16_t humidity;    // Hundredths of a percent relative humidity
+    };
+
+    using MeasurementResult = Result<Measurement, Status>;
+
+    // Called from poll(), for each sample or failed attempt
+    using MeasurementFunc = auto (*)(void *data, const MeasurementResult &result) -> void;
+
+    // The raw values are 20 bits, full scale 100 % and -50 to 150 C
+    static constexpr auto convertHumidity(uint32_t raw) -> uint16_t
+    {
+        // raw * 10000 / 2^20, rounded
+        return static_cast<uint16_t>((raw * 625u + 0x8000u) >> 16);
+    }
+
+    static constexpr auto convertTemperature(uint32_t raw) -> int16_t
+    {
+        // raw * 20000 / 2^20 - 5000, rounded
+        return static_cast<int16_t>(static_cast<int32_t>((raw * 1250u + 0x8000u) >> 16) - 5000);
+    }
+
+    // Status byte, then 20 bits of humidity and 20 bits of temperature
+    static constexpr auto convert(const uint8_t *data) -> Measurement
+    {
+        const uint32_t humidity = (static_cast<uint32_t>(data[1]) << 12) |
+                                  (static_cast<uint32_t>(data[2]) << 4) |
+                                  (static_cast<uint32_t>(data[3]) >> 4);
+        const uint32_t temperature = (static_cast<uint32_t>(data[3] & 0x0F) << 16) |
+                                     (static_cast<uint32_t>(data[4]) << 8) |
+                                     static_cast<uint32_t>(data[5]);
+        return {convertTemperature(temperature), convertHumidity(humidity)};
+    }
+
+    Aht20(AvrI2cController &bus_, SysTimer &clock_, uint8_t address_ = defaultAddress)
+        : bus(bus_), clock(clock_), address(address_)
+    {
+    }
+
+    Aht20(const Aht20 &) = delete;
+    auto operator=(const Aht20 &) -> Aht20 & = delete;
+
+    auto onMeasurement(MeasurementFunc func, void *data) -> void
+    {
+        measurementFunc = func;
+        measurementData = data;
+    }
+
+    // Initialize the sensor, then sample every period ticks
+    auto start(unsigned long period_) -> void
+    {
+        period = period_;
+        initialized = false;
+        sampleStart = clock.getTime() - period;
+        state = State::Waiting;
+    }
+
+    // A transaction in flight still completes, without a callback
+    auto stop() -> void { state = State::Stopped; }
+
+    auto isRunning() const -> bool { return state != State::Stopped; }
+
+    // Last successful measurement
+    auto getLatest() const -> Measurement { return latest; }
+
+    auto poll() -> void
+    {
+        const auto now = clock.getTime();
+
+        switch (state) {
+        case State::Waiting:
+            if (now - sampleStart < period) break;
+            if (initialized ? trigger() : initialize()) sampleStart = now;
+            break;
+        case State::Settling:
+            if (now - waitStart < waitTime) break;
+            initialized = true;
+            trigger();
+            break;
+        case State::Converting:
+            if (now - waitStart < waitTime) break;
+            submit(State::Reading, Transaction::read(address, sample, sizeof(sample)));
+            break;
+        case State::Done:
+            latest = convert(sample);
+            state = State::Waiting;
+            report(MeasurementResult::ok(latest));
+            break;
+        case State::Failed:
+            initialized = false;
+            state = State::Waiting;
+            report(MeasurementResult::err(error));
+            break;
+        default: break; // Stopped, or a transaction in flight
+        }
+    }
+
+private:
+    using Transaction = AvrI2c::Transaction;
+
+    enum class State : uint8_t {
+        Stopped,
+        Waiting,      // For the next sample
+        Initializing, // Transactions in flight
+        Triggering,
+        Reading,
+        Settling, // Timed waits
+        Converting,
+        Done, // Reported from poll()
+        Failed,
+    };
+
+    struct Cmd {
+        static constexpr uint8_t initialize[] = {0xBE, 0x08, 0x00};
+        static constexpr uint8_t measure[] = {0xAC, 0x33, 0x00};
+    };
+
+    static constexpr uint8_t busyBit = 0x80;
+
+    AvrI2cController &bus;
+    SysTimer         &clock;
+    const uint8_t     address;
+
+    volatile State  state {State::Stopped};
+    bool            initialized {false};
+    unsigned long   period {0};
+    unsigned long   sampleStart {0};
+    unsigned long   waitStart {0};
+    unsigned long   waitTime {0};
+    Status          error {Status::Ok};
+    uint8_t         sample[6] {};
+    Measurement     latest {0, 0};
+    MeasurementFunc measurementFunc {nullptr};
+    void           *measurementData {nullptr};
+
+    auto initialize() -> bool
+    {
+        const auto command = Transaction::write(address, Cmd::initialize, sizeof(Cmd::initialize));
+        return submit(State::Initializing, command);
+    }
+
+    auto trigger() -> bool
+    {
+        const auto command = Transaction::write(address, Cmd::measure, sizeof(Cmd::measure));
+        return submit(State::Triggering, command);
+    }
+
+    // The state changes before the completion can come in. A full queue is retried by poll().
+    auto submit(State next, Transaction transaction) -> bool
+    {
+        const auto previous = state;
+        state = next;
+
+        transaction.onComplete = [](void *sensor, Status status) {
+            static_cast<Aht20 *>(sensor)->complete(status);
+        };
+        transaction.callbackData = this;
+        if (bus.trySubmit(transaction)) return true;
+
+        state = previous;
+        return false;
+    }
+
+    // The bus's CompleteFunc, from the interrupt or the bus's poll()
+    auto complete(Status status) -> void
+    {
+        if (state == State::Stopped) return;
+
+        if (status != Status::Ok) {
+            error = status;
+            state = State::Failed;
+            return;
+        }
+
+        switch (state) {
+        case State::Initializing: wait(State::Settling, initTime); break;
+        case State::Triggering: wait(State::Converting, conversionTime); break;
+        case State::Reading:
+            if (sample[0] & busyBit) {
+                wait(State::Converting, retryTime);
+            } else {
+                state = State::Done;
+            }
+            break;
+        default: break;
+        }
+    }
+
+    auto wait(State next, unsigned long time) -> void
+    {
+        waitStart = clock.getTime();
+        waitTime = time;
+        state = next;
+    }
+
+    auto report(const MeasurementResult &result) -> void
+    {
+        if (measurementFunc != nullptr) measurementFunc(measurementData, result);
+    }
+};
+
+static_assert(Aht20::convertHumidity(0) == 0);
+static_assert(Aht20::convertHumidity(0x80000) == 5000);
+static_assert(Aht20::convertHumidity(0xFFFFF) == 10000);
+static_assert(Aht20::convertTemperature(0) == -5000);
+static_assert(Aht20::convertTemperature(0x40000) == 0);
+static_assert(Aht20::convertTemperature(0xFFFFF) == 15000);
+
+} // namespace liquid
+
+#endif
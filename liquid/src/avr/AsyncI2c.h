@@ -0,0 +1,107 @@
+#ifndef LIQUID_ASYNC_I2C_H_
+#define LIQUID_ASYNC_I2C_H_
+
+#include "../Async.h"
+#include "AvrI2c.h"
+
+namespace liquid
+{
+
+/*
+ * Awaitable I2C transactions, queued on the controller like the non-blocking
+ * ones. The completion callback posts the coroutine to its executor from the
+ * interrupt.
+ *
+ *     AsyncI2c i2c {bus};
+ *     const auto status = co_await i2c.writeRead(address, &reg, 1, data, sizeof(data));
+ *
+ * The buffers are only used until the co_await returns, so locals of the
+ * coroutine are fine.
+ */
+class AsyncI2c
+{
+public:
+    using Status = AvrI2c::Status;
+    using Transaction = AvrI2c::Transaction;
+    using Segment = AvrI2c::Segment;
+
+    explicit AsyncI2c(AvrI2cController &bus_) : bus(bus_) {}
+
+    /*
+     * Submits without sleeping. With the controller's queue full the coroutine
+     * waits on the executor instead, which retries the submit after each
+     * wake-up and resumes it once the transaction has finished.
+     */
+    struct Awaiter : AsyncWait {
+        AvrI2cController &bus;
+        Transaction       transaction;
+        Executor         *executor {nullptr};
+        Status            status {Status::InProgress};
+        bool              parked {false};
+        bool              submitted {false};
+
+        Awaiter(AvrI2cController &bus_, const Transaction &transaction_)
+            : bus(bus_), transaction(transaction_)
+        {
+        }
+
+        auto await_ready() const noexcept -> bool { return false; }
+
+        template <class P> auto await_suspend(std::coroutine_handle<P> h) -> void
+        {
+            executor = h.promise().executor;
+            handle = h;
+            transaction.onComplete = [](void *a, Status result) {
+                auto *awaiter = static_cast<Awaiter *>(a);
+                awaiter->status = result;
+                if (!awaiter->parked) awaiter->executor->post(awaiter->handle);
+            };
+            transaction.callbackData = this;
+            if (bus.trySubmit(transaction)) return;
+
+            parked = true;
+            isReady = [](AsyncWait &w) { return static_cast<Awaiter &>(w).check(); };
+            executor->wait(*this);
+        }
+
+        auto check() -> bool
+        {
+            if (!submitted) submitted = bus.trySubmit(transaction);
+
+            NoInterruptsGuard guard;
+            return status != Status::InProgress;
+        }
+
+        auto await_resume() const -> Status { return status; }
+    };
+
+    auto write(uint8_t address, const uint8_t *data, size_t size) -> Awaiter
+    {
+        return {bus, Transaction::write(address, data, size)};
+    }
+
+    auto write(uint8_t address, const Segment *segments, uint8_t count) -> Awaiter
+    {
+        return {bus, Transaction::write(address, segments, count)};
+    }
+
+    auto read(uint8_t address, uint8_t *data, size_t size) -> Awaiter
+    {
+        return {bus, Transaction::read(address, data, size)};
+    }
+
+    auto writeRead(uint8_t address, const uint8_t *txData, size_t txSize, uint8_t *rxData,
+                   size_t rxSize) -> Awaiter
+    {
+        return {bus, Transaction::writeRead(address, txData, txSize, rxData, rxSize)};
+    }
+
+    auto probe(uint8_t address) -> Awaiter { return {bus, Transaction::probe(address)}; }
+
+private:
+    AvrI2cController &bus;
+};
+
+} // namespace liquid
+
+#endif
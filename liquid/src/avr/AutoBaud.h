@@ -0,0 +1,208 @@
+#ifndef LIQUID_AUTO_BAUD_H_
+#define LIQUID_AUTO_BAUD_H_
+
+#include "../util.h"
+#include "AvrTimer16.h"
+#include "AvrUsart.h"
+
+namespace liquid
+{
+
+/*
+ * Baud rate detection with 16-bit timer input capture.
+ *
+ * The peer sends the sync character 0x55 ('U'). Sent LSB first, its start bit and
+ * data bits 1, 3, 5 and 7 begin with a falling edge, so the five falling edges
+ * span exactly 8 bit times, independent of the baud rate.
+ *
+ * The RX line must also be wired to the timer's ICP pin (ICP1 is D8 on the Nano,
+ * ICP4 is D49 and ICP5 is D48 on the Mega). The timer is reconfigured for the
+ * measurement and is not restored.
+ *
+ * The timer runs at fCpu and the character must fit in one timer period, which
+ * sets the lowest rate to minBaud(), about 2000 baud at 16 MHz. The capture flag
+ * is polled and ICR only holds the last edge: consecutive edges are two bit
+ * times apart, which must leave time to read it. That sets the highest rate to
+ * maxBaud(), 500000 baud at 16 MHz. Faster peers are reported as Unsupported.
+ */
+class AutoBaud
+{
+public:
+    enum class Error {
+        Timeout,     // no sync character before the timer overflowed maxOverflows times
+        InvalidSync, // edges not evenly spaced, the character was not 0x55
+        Unsupported, // baud rate above maxBaud() or not achievable with the USART
+    };
+
+    static constexpr int syncEdges = 5;
+    static constexpr int syncBitTimes = 8;
+
+    static constexpr unsigned int defaultMaxOverflows = 1000;
+
+    // Measured rates within this distance in percent snap to the standard rate
+    static constexpr unsigned long snapPercent = 3;
+
+    // The ones measurable at 16 MHz, see minBaud() and maxBaud()
+    static constexpr unsigned long standardRates[] = {
+        2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 76800, 115200, 230400, 250000, 500000,
+    };
+    static constexpr int standardRateCount = sizeof(standardRates) / sizeof(*standardRates);
+
+    // 8 bit times within 65536 timer ticks
+    static constexpr auto minBaud(unsigned long fCpu) -> unsigned long
+    {
+        return fCpu / (65536 / syncBitTimes) + 1;
+    }
+
+    // At least 64 cycles between edges, for the polling loop to read each capture
+    static constexpr auto maxBaud(unsigned long fCpu) -> unsigned long { return fCpu / 32; }
+
+    // Baud rate from the capture timestamps of the sync character, 0 if the edges
+    // are not evenly spaced. Timestamps may wrap around, as long as the whole
+    // character fits in one timer period.
+    static constexpr auto estimate(unsigned long fTimer, const uint16_t (&edges)[syncEdges])
+        -> unsigned long
+    {
+        const auto total = static_cast<uint16_t>(edges[syncEdges - 1] - edges[0]);
+        if (total == 0) return 0;
+
+        // Each interval is two bit times, allow a quarter bit time of jitter
+        const auto expected = total / (syncEdges - 1);
+        for (int i = 1; i < syncEdges; ++i) {
+            const auto interval = static_cast<uint16_t>(edges[i] - edges[i - 1]);
+            const auto diff = interval > expected ? interval - expected : expected - interval;
+            if (diff * 8 > expected) return 0;
+        }
+
+        return (fTimer * syncBitTimes + total / 2) / total;
+    }
+
+    static constexpr auto snap(unsigned long baud) -> unsigned long
+    {
+        for (const auto rate : standardRates) {
+            const auto diff = baud > rate ? baud - rate : rate - baud;
+            if (diff * 100 <= snapPercent * rate) return rate;
+        }
+        return baud;
+    }
+
+    AutoBaud(AvrTimer16 timer_, unsigned long fCpu_) : timer(timer_), fCpu(fCpu_) {}
+
+    // Wait for the sync character by polling the input capture flag
+    auto detect(unsigned int maxOverflows_ = defaultMaxOverflows) -> Result<unsigned long, Error>
+    {
+        start(maxOverflows_);
+        while (!poll())
+            ;
+        return result;
+    }
+
+    // detect() in steps: start(), then poll() back to back until it returns true
+    auto start(unsigned int maxOverflows_ = defaultMaxOverflows) -> void
+    {
+        using CS = AvrTimer16::ClockSelect;
+
+        timer.TIMSK().ICIE = 0;
+        timer.writeWgm(AvrTimer16::WaveformGenerationMode::Normal);
+        timer.TCCRB().ICNC = 1;
+        timer.TCCRB().ICES = 0; // Falling edge
+        timer.TCCRB().CS = CS::ClkIo;
+
+        maxOverflows = maxOverflows_;
+        overflows = 0;
+        wraps = 0;
+        count = 0;
+        tifr() = icf | tov;
+    }
+
+    // Handles a pending capture or overflow, true once the result is there
+    auto poll() -> bool
+    {
+        // Flags are cleared by writing 1, write them alone to keep the other one
+        auto &flags = tifr();
+
+        if (flags & icf) {
+            if (count == 0) wraps = 0;
+            edges[count++] = timer.ICR();
+            flags = icf;
+            if (count < syncEdges) return false;
+
+            finish(Error::InvalidSync);
+            return true;
+        }
+
+        if (flags & tov) {
+            flags = tov;
+
+            // The character must fit in one timer period, otherwise start over
+            if (count > 0 && ++wraps > 1) count = 0;
+            if (++overflows >= maxOverflows) {
+                finish(Error::Timeout);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto getResult() const -> Result<unsigned long, Error> { return result; }
+
+    // Detect and switch the UART to the peer's rate. Uart is Usart or an AVR driver.
+    template <class Uart>
+    auto run(Uart &uart, unsigned int maxOverflows_ = defaultMaxOverflows)
+        -> Result<unsigned long, Error>
+    {
+        const auto detected = detect(maxOverflows_);
+        if (!detected) return detected;
+
+        if (!uart.setBaud(fCpu, detected.getValue())) {
+            return Result<unsigned long, Error>::err(Error::Unsupported);
+        }
+
+        // Drop whatever was received at the old rate
+        while (uart.isRxReady())
+            uart.rx();
+
+        return detected;
+    }
+
+private:
+    static constexpr uint8_t icf = 1 << 5;
+    static constexpr uint8_t tov = 1 << 0;
+
+    AvrTimer16    timer;
+    unsigned long fCpu;
+
+    Result<unsigned long, Error> result {};
+    uint16_t                     edges[syncEdges] = {};
+    unsigned int                 maxOverflows = defaultMaxOverflows;
+    unsigned int                 overflows = 0;
+    uint8_t                      wraps = 0;
+    uint8_t                      count = 0;
+
+    auto tifr() -> Sfr8 { return sfr8(timer.TIFR().regAddr); }
+
+    // The timer stops, with the error unless all edges were captured
+    auto finish(Error error) -> void
+    {
+        timer.TCCRB().CS = AvrTimer16::ClockSelect::None;
+
+        const auto baud = count == syncEdges ? estimate(fCpu, edges) : 0;
+        if (baud == 0) {
+            result = Result<unsigned long, Error>::err(error);
+        } else if (baud > maxBaud(fCpu)) {
+            result = Result<unsigned long, Error>::err(Error::Unsupported);
+        } else {
+            result = Result<unsigned long, Error>::ok(snap(baud));
+        }
+    }
+};
+
+static_assert(AutoBaud::snap(9500) == 9600);
+static_assert(AutoBaud::snap(100000) == 100000);
+static_assert(AutoBaud::minBaud(16000000) < AutoBaud::standardRates[0]);
+static_assert(AutoBaud::maxBaud(16000000) >=
+              AutoBaud::standardRates[AutoBaud::standardRateCount - 1]);
+
+} // namespace liquid
+
+#endif
@@ -2,6 +2,7 @@
 #define AVRADC_H_
 
 #include "../Reg.h"
+#include "../Sys.h"
 
 namespace liquid
 {
@@ -58,9 +59,11 @@ private:
     inline auto ADC() const { return sfr16(base); }
 
 public:
+    // The conversion complete interrupt only wakes the CPU, the board's ADC_vect is empty
     constexpr AvrAdc(uint16_t base_) : base(base_)
     {
         ADCSRA().ADEN = 1;
+        ADCSRA().ADIE = 1;
         ADMUX().REFS = Refs::Avcc;
     }
 
@@ -72,13 +75,29 @@ public:
         ADMUX().MUX40 = channel & 0x1f;
     }
 
+    // Sleeps in Idle mode during the conversion
     auto readRaw(int channel) -> unsigned int
+    {
+        return convert(channel, Sys::SleepMode::Idle);
+    }
+
+    /*
+     * Sleeps in ADC Noise Reduction mode, with the CPU and I/O clocks stopped
+     * during the conversion. Timers 0 and 1, the USARTs and the TWI pause too,
+     * bytes arriving meanwhile are lost.
+     */
+    auto readRawLowNoise(int channel) -> unsigned int
+    {
+        return convert(channel, Sys::SleepMode::AdcNoiseReduction);
+    }
+
+private:
+    auto convert(int channel, Sys::SleepMode mode) -> unsigned int
     {
         selectChannel(channel);
 
         ADCSRA().ADSC = 1;
-        while (ADCSRA().ADSC == 1)
-            ;
+        Sys::waitUntil([&] { return ADCSRA().ADSC == 0; }, mode);
 
         return ADC();
     }
@@ -2,12 +2,21 @@
 #define LIQUID_AVRI2C_H_
 
 #include "AvrInterrupts.h"
+#include "Gpio.h"
 #include "../Interrupts.h"
 #include "../Reg.h"
+#include "../RingBuffer.h"
+#include "../Sys.h"
+#include "../SysTimer.h"
 #include "../util.h"
 
 #include <assert.h>
 #include <math.h>
+#include <util/delay_basic.h>
+
+#ifndef LIQUID_I2C_QUEUE_SIZE
+#define LIQUID_I2C_QUEUE_SIZE 4
+#endif
 
 namespace liquid
 {
@@ -33,9 +42,83 @@ public:
         Nack,
         ArbitrationLost,
         BusError,
+        Timeout, // Aborted after the deadline, the bus was recovered
         Unknown,
     };
 
+    /*
+     * Called when a transaction has finished: from the TWI interrupt, or from
+     * poll() for a transaction aborted on its deadline. Either way with the
+     * interrupts disabled, so keep it short.
+     */
+    using CompleteFunc = auto (*)(void *data, Status status) -> void;
+
+    // Part of a scatter-gather write
+    struct Segment {
+        const uint8_t *data;
+        size_t         size;
+    };
+
+    /*
+     * The write phase sends txData, then each of the segments, without copying.
+     * The buffers and the segment list must stay valid until onComplete.
+     */
+    struct Transaction {
+        enum class Op : uint8_t { Write, Read, Probe, WriteRead };
+
+        Op             op;
+        uint8_t        address;
+        const uint8_t *txData;
+        size_t         txSize;
+        const Segment *segments;
+        uint8_t        segmentCount;
+        uint8_t       *rxData; // Read, or WriteRead after a repeated START
+        size_t         rxSize;
+        CompleteFunc   onComplete;
+        void          *callbackData;
+
+        static constexpr auto write(uint8_t address, const uint8_t *data, size_t size,
+                                    CompleteFunc onComplete = nullptr,
+                                    void        *callbackData = nullptr) -> Transaction
+        {
+            return {Op::Write, address, data, size, nullptr, 0, nullptr, 0, onComplete,
+                    callbackData};
+        }
+
+        static constexpr auto write(uint8_t address, const Segment *segments, uint8_t count,
+                                    CompleteFunc onComplete = nullptr,
+                                    void        *callbackData = nullptr) -> Transaction
+        {
+            return {Op::Write, address, nullptr, 0, segments, count, nullptr, 0, onComplete,
+                    callbackData};
+        }
+
+        static constexpr auto read(uint8_t address, uint8_t *data, size_t size,
+                                   CompleteFunc onComplete = nullptr,
+                                   void        *callbackData = nullptr) -> Transaction
+        {
+            return {Op::Read, address, nullptr, 0, nullptr, 0, data, size, onComplete,
+                    callbackData};
+        }
+
+        static constexpr auto probe(uint8_t address, CompleteFunc onComplete = nullptr,
+                                    void *callbackData = nullptr) -> Transaction
+        {
+            return {Op::Probe, address, nullptr, 0, nullptr, 0, nullptr, 0, onComplete,
+                    callbackData};
+        }
+
+        // Typically a register address, then its contents, without releasing the bus
+        static constexpr auto writeRead(uint8_t address, const uint8_t *txData, size_t txSize,
+                                        uint8_t *rxData, size_t rxSize,
+                                        CompleteFunc onComplete = nullptr,
+                                        void        *callbackData = nullptr) -> Transaction
+        {
+            return {Op::WriteRead, address, txData, txSize, nullptr, 0, rxData, rxSize,
+                    onComplete, callbackData};
+        }
+    };
+
     enum class Prescaler {
         Div1 = 0,
         Div4 = 1,
@@ -149,112 +232,225 @@ public:
         TWCR().TWEN = 0;
     }
 
+    /*
+     * Queue a transaction, it starts as soon as the previous ones are done. The
+     * interrupt chains from one transaction to the next, the CPU does not wait in
+     * between. The buffer must stay valid until onComplete is called.
+     *
+     * Sleeps while the queue is full. From the interrupt context, e.g. to chain
+     * a follow-up from onComplete, use trySubmit() instead.
+     */
+    auto submit(const Transaction &transaction) -> void
+    {
+        Sys::waitUntil([&] {
+            poll();
+            return trySubmit(transaction);
+        });
+    }
+
+    // Returns false when the queue is full
+    auto trySubmit(const Transaction &transaction) -> bool
+    {
+        NoInterruptsGuard guard;
+
+        if (mode_func == &AvrI2cController::idle) {
+            begin(transaction);
+            return true;
+        }
+        return queue.push(transaction);
+    }
+
     auto blockingWriteByte(uint8_t address, uint8_t data) -> Result<void, Status>
     {
-        write(address, &data, 1);
-        waitForIdle();
+        const auto result = run(Transaction::write(address, &data, 1));
 
-        if (status == Status::Ok) {
+        if (result == Status::Ok) {
             return Result<void, Status>::ok();
         } else {
-            return Result<void, Status>::err(Status {status});
+            return Result<void, Status>::err(Status {result});
         }
     }
 
-    auto blockingWrite(uint8_t address, uint8_t *data, size_t size) -> Result<uint8_t *, Status>
+    auto blockingWrite(uint8_t address, const uint8_t *data, size_t size)
+        -> Result<const uint8_t *, Status>
     {
-        write(address, data, size);
-        waitForIdle();
-        if (status == Status::Ok) {
-            return Result<uint8_t *, Status>::ok(data);
+        const auto result = run(Transaction::write(address, data, size));
+        if (result == Status::Ok) {
+            return Result<const uint8_t *, Status>::ok(data);
         } else {
-            return Result<uint8_t *, Status>::err(Status {status});
+            return Result<const uint8_t *, Status>::err(Status {result});
         }
     }
 
-    auto write(uint8_t address, uint8_t *data, size_t size) -> void
+    auto write(uint8_t address, const uint8_t *data, size_t size) -> void
     {
-        waitForIdle();
+        submit(Transaction::write(address, data, size));
+    }
 
-        mode_func = &AvrI2cController::write_func;
-        pendingAddress = address;
-        currentData = data;
-        dataSize = size;
+    // Scatter-gather write, e.g. a command prefix and a payload from wherever it lives
+    auto blockingWrite(uint8_t address, const Segment *segments, uint8_t count)
+        -> Result<void, Status>
+    {
+        const auto result = run(Transaction::write(address, segments, count));
+        if (result == Status::Ok) {
+            return Result<void, Status>::ok();
+        } else {
+            return Result<void, Status>::err(Status {result});
+        }
+    }
 
-        start();
+    auto write(uint8_t address, const Segment *segments, uint8_t count) -> void
+    {
+        submit(Transaction::write(address, segments, count));
     }
 
     auto blockingReadByte(uint8_t address) -> Result<uint8_t, Status>
     {
-        uint8_t data {0};
-        read(address, &data, 1);
-        waitForIdle();
+        uint8_t    data {0};
+        const auto result = run(Transaction::read(address, &data, 1));
 
-        if (status == Status::Ok) {
+        if (result == Status::Ok) {
             return Result<uint8_t, Status>::ok(data);
         } else {
-            return Result<uint8_t, Status>::err(Status {status});
+            return Result<uint8_t, Status>::err(Status {result});
         }
     }
 
     auto blockingRead(uint8_t address, uint8_t *data, size_t size) -> Result<uint8_t *, Status>
     {
-        read(address, data, size);
-        waitForIdle();
-        if (status == Status::Ok) {
+        const auto result = run(Transaction::read(address, data, size));
+        if (result == Status::Ok) {
             return Result<uint8_t *, Status>::ok(data);
         } else {
-            return Result<uint8_t *, Status>::err(Status {status});
+            return Result<uint8_t *, Status>::err(Status {result});
         }
     }
 
     auto read(uint8_t address, uint8_t *data, size_t size) -> void
     {
-        waitForIdle();
+        submit(Transaction::read(address, data, size));
+    }
 
-        mode_func = &AvrI2cController::read_func;
-        pendingAddress = address;
-        currentData = data;
-        dataSize = size;
+    /*
+     * Write, then read after a repeated START instead of a STOP. The bus is not
+     * released in between, so no other controller can get in, e.g. between
+     * setting a register address and reading the register.
+     */
+    auto writeRead(uint8_t address, const uint8_t *txData, size_t txSize, uint8_t *rxData,
+                   size_t rxSize) -> void
+    {
+        submit(Transaction::writeRead(address, txData, txSize, rxData, rxSize));
+    }
 
-        start();
+    auto blockingWriteRead(uint8_t address, const uint8_t *txData, size_t txSize,
+                           uint8_t *rxData, size_t rxSize) -> Result<uint8_t *, Status>
+    {
+        const auto result = run(Transaction::writeRead(address, txData, txSize, rxData, rxSize));
+        if (result == Status::Ok) {
+            return Result<uint8_t *, Status>::ok(rxData);
+        } else {
+            return Result<uint8_t *, Status>::err(Status {result});
+        }
     }
 
     auto probe(uint8_t address)
     {
-        waitForIdle();
-
-        mode_func = &AvrI2cController::probe_func;
-        pendingAddress = address;
-        currentData = nullptr;
-        dataSize = 0;
-
-        start();
+        submit(Transaction::probe(address));
     }
 
+    // Not queued, waits for the queue to drain. Later submissions wait for the scan.
     auto scan(ScanCallback callback)
     {
-        waitForIdle();
-
-        scanCallback = callback;
-        mode_func = &AvrI2cController::scan_func;
-        pendingAddress = 0;
-        currentData = 0;
-        dataSize = 0;
-
-        start();
+        Sys::waitUntil([&] {
+            poll();
+            if (mode_func != &AvrI2cController::idle) return false;
+
+            current = Transaction::probe(0);
+            scanCallback = callback;
+            mode_func = &AvrI2cController::scan_func;
+            pendingAddress = 0;
+            currentData = nullptr;
+            dataSize = 0;
+
+            start();
+            return true;
+        });
     }
 
+    // Sleeps until all queued transactions are done, returns the status of the last one
     auto waitForIdle() -> Status
     {
-        while (status == Status::InProgress)
-            ;
+        Sys::waitUntil([&] {
+            poll();
+            return status != Status::InProgress;
+        });
 
         return status;
     }
 
+    // Bus recovery waits at least 5 us per half period up to 20 MHz, a 100 kHz
+    // clock. _delay_loop_1() takes 3 cycles per count.
+    static constexpr uint8_t  recoveryDelayCount  = 34;
+    static constexpr unsigned recoveryDelayCycles = 3 * recoveryDelayCount;
+
+    // Release SCL, 9 clock pulses, then the STOP
+    static constexpr unsigned recoveryHalfPeriods = 1 + 9 * 2 + 4;
+
+    /*
+     * Abort a transaction that is still running after timeout ticks of the
+     * clock, e.g. a target holding SDA low or a lost interrupt. It finishes
+     * with Status::Timeout and the queue goes on with the next one. A scan
+     * gets the timeout for each address.
+     *
+     * With the pins set, the bus is recovered first: SCL is clocked until the
+     * target releases SDA, at most 9 times, then a STOP is sent. That is at
+     * most recoveryHalfPeriods busy-waits of recoveryDelayCycles, under 0.2 ms
+     * at 16 MHz, with the interrupts disabled.
+     */
+    auto setTimeout(SysTimer &clock_, unsigned long timeout_) -> void
+    {
+        NoInterruptsGuard guard;
+        clock = &clock_;
+        timeout = timeout_;
+    }
+
+    // SCL and SDA of the TWI, Board::Gpio::SCL and SDA
+    auto setRecoveryPins(Gpio &scl_, Gpio &sda_) -> void
+    {
+        NoInterruptsGuard guard;
+        scl = &scl_;
+        sda = &sda_;
+    }
+
+    /*
+     * Check the deadline. The blocking functions call it while waiting, woken
+     * by the clock's interrupt. With the non-blocking ones call it from the
+     * main loop. The worst case latency is the timeout plus the time between
+     * calls. An aborted transaction calls onComplete and onReady from here.
+     */
+    auto poll() -> void
+    {
+        if (clock == nullptr) return;
+
+        const auto now = clock->getTime();
+
+        NoInterruptsGuard guard;
+        if (mode_func == &AvrI2cController::idle) return;
+
+        if (started != watched) {
+            watched = started;
+            startTime = now;
+        } else if (now - startTime >= timeout) {
+            abortTransaction();
+        }
+    }
+
+    // InProgress while transactions are running or queued
     auto getStatus() const { return status; }
 
+    auto getQueuedCount() const -> uint8_t { return queue.size(); }
+
+    // Called when the queue has drained, from the same contexts as CompleteFunc
     auto onReady(ReadyCallback cb) -> void { readyCallback = cb; }
 
     auto isr() -> void
@@ -262,6 +458,9 @@ public:
         lastStatusCode = readStatus();
         (this->*mode_func)(lastStatusCode);
         TWCR().TWINT = 1; // clear interrupt flag
+
+        // With TWINT cleared the STOP goes out, the callbacks don't hold the bus
+        if (completed) complete();
     }
 
 private:
@@ -286,12 +485,27 @@ private:
 
     volatile uint8_t  pendingAddress {0};
     volatile uint8_t *currentData {nullptr};
+    const uint8_t    *currentTx {nullptr};
+    const Segment    *nextSegment {nullptr};
+    uint8_t           segmentsLeft {0};
     volatile size_t   dataSize {0};
     volatile uint8_t  lastStatusCode {0};
     volatile Status   status {Status::Ok};
-    volatile Status   pendingStatus {Status::Ok};
     ReadyCallback     readyCallback {[](void *) {}, nullptr};
     ScanCallback      scanCallback {[](uint8_t, bool) {}};
+    Transaction       current {};
+    Transaction       done {}; // Finished, callbacks pending
+    Status            doneStatus {Status::Ok};
+    bool              completed {false};
+    SysTimer         *clock {nullptr};
+    unsigned long     timeout {0};
+    unsigned long     startTime {0};
+    volatile unsigned started {0}; // Counts transactions, and addresses of a scan
+    unsigned          watched {0};
+    Gpio             *scl {nullptr};
+    Gpio             *sda {nullptr};
+
+    RingBuffer<Transaction, LIQUID_I2C_QUEUE_SIZE> queue;
 
     void (AvrI2cController::*mode_func)(uint8_t) = &AvrI2cController::idle;
 
@@ -325,6 +539,7 @@ private:
         case StatusCode::WriteAddressAckRxd:
             scanCallback(pendingAddress, true);
             if (++pendingAddress <= 127) {
+                ++started;
                 TWCR().TWSTA = 1;
                 break;
             } else {
@@ -334,6 +549,7 @@ private:
         case StatusCode::WriteAddressNackRxd:
             scanCallback(pendingAddress, false);
             if (++pendingAddress <= 127) {
+                ++started;
                 TWCR().TWSTA = 1;
                 break;
             } else {
@@ -349,20 +565,45 @@ private:
         switch (statusCode) {
         case StatusCode::StartTxd:
         case StatusCode::RepeatedStartTxd: handleStart(Mode::Write); break;
-        case StatusCode::WriteAddressAckRxd: writeData(*currentData++); break;
+        case StatusCode::WriteAddressAckRxd: writeNext(); break;
         case StatusCode::WriteAddressNackRxd: finish(Status::Nack); break;
         case StatusCode::DataAckRxd:
-            if (--dataSize != 0) {
-                writeData(*currentData++);
-            } else {
-                finish(Status::Ok);
-            }
+            --dataSize;
+            writeNext();
             break;
         case StatusCode::DataNackRxd: finish(Status::Nack); break;
         default: finish(codeToStatus(statusCode)); break;
         }
     }
 
+    auto writeNext() -> void
+    {
+        while (dataSize == 0 && segmentsLeft != 0) {
+            currentTx = nextSegment->data;
+            dataSize = nextSegment->size;
+            ++nextSegment;
+            --segmentsLeft;
+        }
+
+        if (dataSize != 0) {
+            writeData(*currentTx++);
+        } else if (current.op == Transaction::Op::WriteRead) {
+            repeatedStart();
+        } else {
+            finish(Status::Ok);
+        }
+    }
+
+    // Switch to the read phase of a WriteRead, keeping the bus
+    auto repeatedStart() -> void
+    {
+        mode_func = &AvrI2cController::read_func;
+        currentData = current.rxData;
+        dataSize = current.rxSize;
+        TWCR().TWEA = 1;
+        TWCR().TWSTA = 1;
+    }
+
     auto read_func(uint8_t statusCode) -> void
     {
         switch (statusCode) {
@@ -390,36 +631,158 @@ private:
         }
     }
 
-    auto wait_for_stop_func(uint8_t) -> void
+    auto begin(const Transaction &transaction) -> void
     {
-        status = pendingStatus;
-        pendingStatus = Status::Unknown;
-        mode_func = &AvrI2cController::idle;
-        readyCallback();
+        load(transaction);
+        start();
+    }
+
+    auto load(const Transaction &transaction) -> void
+    {
+        current = transaction;
+        switch (transaction.op) {
+        case Transaction::Op::Write:
+        case Transaction::Op::WriteRead: mode_func = &AvrI2cController::write_func; break;
+        case Transaction::Op::Read: mode_func = &AvrI2cController::read_func; break;
+        case Transaction::Op::Probe: mode_func = &AvrI2cController::probe_func; break;
+        }
+        pendingAddress = transaction.address;
+        currentTx = transaction.txData;
+        nextSegment = transaction.segments;
+        segmentsLeft = transaction.segmentCount;
+        if (transaction.op == Transaction::Op::Read) {
+            currentData = transaction.rxData;
+            dataSize = transaction.rxSize;
+        } else {
+            currentData = nullptr;
+            dataSize = transaction.txSize;
+        }
+    }
+
+    // Submit and wait for this transaction only
+    auto run(Transaction transaction) -> Status
+    {
+        struct Waiter {
+            volatile Status status;
+        } waiter {Status::InProgress};
+
+        transaction.onComplete = [](void *w, Status result) {
+            static_cast<Waiter *>(w)->status = result;
+        };
+        transaction.callbackData = &waiter;
+        submit(transaction);
+
+        Sys::waitUntil([&] {
+            poll();
+            return waiter.status != Status::InProgress;
+        });
+        return waiter.status;
     }
 
     auto start() -> void
     {
+        prepareStart();
+        TWCR().TWINT = 1;
+    }
+
+    // The START goes out once TWINT is cleared
+    auto prepareStart() -> void
+    {
+        ++started;
         status = Status::InProgress;
-        pendingStatus = Status::Unknown;
         lastStatusCode = 0;
 
         TWCR().TWEA = 1;
         TWCR().TWSTA = 1;
-        TWCR().TWINT = 1;
     }
 
-    auto finish(Status status_) -> void
+    /*
+     * The STOP goes out once isr() clears TWINT, and no interrupt follows it.
+     * So the transaction is done here. The next queued one starts right away,
+     * with TWSTO and TWSTA both set the TWI sends a STOP, then a START.
+     */
+    auto finish(Status result) -> void
     {
-        // Setting TWSTO will send the stop bit. After it has been sent,
-        // TWINT interrupt will trigger one last time. Only then the operation
-        // is finished and the device is ready to start another one.
-        pendingStatus = status_;
-        mode_func = &AvrI2cController::wait_for_stop_func;
-        TWCR().TWSTA = 0;
+        if (retire(result)) {
+            prepareStart();
+        } else {
+            TWCR().TWSTA = 0;
+        }
         TWCR().TWSTO = 1;
     }
 
+    // Keep the result for complete() and load the next queued transaction, if any
+    auto retire(Status result) -> bool
+    {
+        done = current;
+        doneStatus = result;
+        completed = true;
+
+        Transaction next;
+        if (queue.pop(next)) {
+            load(next);
+            return true;
+        }
+
+        mode_func = &AvrI2cController::idle;
+        status = result;
+        return false;
+    }
+
+    auto complete() -> void
+    {
+        completed = false;
+        if (done.onComplete != nullptr) done.onComplete(done.callbackData, doneStatus);
+        if (mode_func == &AvrI2cController::idle) readyCallback();
+    }
+
+    // Called with the interrupts disabled
+    auto abortTransaction() -> void
+    {
+        // Without TWEN the pins are back to the GPIO
+        sfr8(TWCR_addr()) = 0;
+        if (scl != nullptr && sda != nullptr) recoverBus(*scl, *sda);
+        TWCR().TWEN = 1;
+        TWCR().TWIE = 1;
+
+        if (retire(Status::Timeout)) start();
+        complete();
+    }
+
+    static auto recoverBus(Gpio &scl, Gpio &sda) -> void
+    {
+        sda.asInput(Gpio::Pullup::PullUp);
+        release(scl);
+
+        // A target holding SDA low is in the middle of a byte, clock it out
+        for (int i = 0; i < 9 && sda.get() == 0; ++i) {
+            pullLow(scl);
+            release(scl);
+        }
+
+        // STOP, SDA rising while SCL is high
+        pullLow(scl);
+        pullLow(sda);
+        release(scl);
+        release(sda);
+    }
+
+    // Open drain, each edge followed by half a clock period
+    static auto pullLow(Gpio &pin) -> void
+    {
+        pin.setLow();
+        pin.asOutput();
+        recoveryDelay();
+    }
+
+    static auto release(Gpio &pin) -> void
+    {
+        pin.asInput(Gpio::Pullup::PullUp);
+        recoveryDelay();
+    }
+
+    static auto recoveryDelay() -> void { _delay_loop_1(recoveryDelayCount); }
+
     auto codeToStatus(uint8_t statusCode) -> Status
     {
         switch (statusCode) {
@@ -444,6 +807,183 @@ private:
     auto readData() const -> uint8_t { return sfr8(TWDR_addr()); }
 };
 
+
+/*
+ * TWI target (slave) serving a register map from the interrupt.
+ *
+ * A write transaction starts with the register number, the following bytes go
+ * to consecutive registers. A read transaction returns consecutive registers
+ * from the current register number, so the controller reads registers with a
+ * write of the register number, a repeated START and a read. Past the end of
+ * the map, and below firstWritable for writes, data bytes are NACKed and reads
+ * return 0xFF.
+ *
+ * The TWI holds SCL low from the interrupt until TWINT is cleared. The handler
+ * only moves one byte and clears TWINT in the same TWCR write, the commit
+ * callback runs after that.
+ *
+ * Controller and target share the TWI interrupt, the last one constructed
+ * gets it.
+ */
+class AvrI2cTarget : public AvrI2c
+{
+public:
+    // Called from the interrupt context after a write transaction, with the
+    // registers written. The map may be updated again by the next transaction.
+    using CommitFunc = auto (*)(void *data, uint8_t first, uint8_t count) -> void;
+
+    AvrI2cTarget()
+    {
+        installIrqHandler(Irq::Twi,
+                          IrqHandler::callMemberFunc<AvrI2cTarget, &AvrI2cTarget::isr>(this));
+    }
+
+    ~AvrI2cTarget() { disable(); }
+
+    /*
+     * Answer on address, and on every address that differs from it only in the
+     * bits set in mask. The general call address 0 is answered if enabled.
+     */
+    auto setup(uint8_t address, uint8_t mask = 0, bool generalCall = false) -> void
+    {
+        sfr8(TWAR_addr()) = static_cast<uint8_t>((address << 1) | (generalCall ? 1 : 0));
+        sfr8(TWAMR_addr()) = static_cast<uint8_t>(mask << 1);
+        sfr8(TWCR_addr()) = listen;
+    }
+
+    auto disable() -> void { sfr8(TWCR_addr()) = 0; }
+
+    /*
+     * The map is accessed from the interrupt, read multi-byte values with the
+     * interrupts disabled or from the commit callback.
+     */
+    auto setRegisters(volatile uint8_t *registers_, uint8_t size_, uint8_t firstWritable_ = 0)
+        -> void
+    {
+        NoInterruptsGuard guard;
+        registers = registers_;
+        size = size_;
+        firstWritable = firstWritable_;
+        pointer = 0;
+    }
+
+    auto onCommit(CommitFunc func, void *data) -> void
+    {
+        NoInterruptsGuard guard;
+        commitFunc = func;
+        commitData = data;
+    }
+
+    // Address of the last transaction, one of several with an address mask
+    auto getAddressed() const -> uint8_t { return addressed; }
+
+    auto isr() -> void
+    {
+        uint8_t control = listen;
+        bool    commit = false;
+
+        switch (static_cast<uint8_t>(TWSR().TWS)) {
+        case StatusCode::WriteAddressAck:
+        case StatusCode::ArbitrationLostWriteAddress:
+        case StatusCode::GeneralCallAck:
+        case StatusCode::ArbitrationLostGeneralCall:
+            addressed = static_cast<uint8_t>(sfr8(TWDR_addr()) >> 1);
+            expectPointer = true;
+            writeCount = 0;
+            break;
+        case StatusCode::DataRxdAck:
+        case StatusCode::GeneralCallDataRxdAck:
+            receive(sfr8(TWDR_addr()));
+            if (!isWritable(pointer)) control &= ~twea;
+            break;
+        case StatusCode::DataRxdNack:
+        case StatusCode::GeneralCallDataRxdNack:
+        case StatusCode::StopOrRepeatedStart: commit = writeCount != 0; break;
+        case StatusCode::ReadAddressAck:
+        case StatusCode::ArbitrationLostReadAddress:
+            addressed = static_cast<uint8_t>(sfr8(TWDR_addr()) >> 1);
+            sfr8(TWDR_addr()) = transmit();
+            break;
+        case StatusCode::DataTxdAck: sfr8(TWDR_addr()) = transmit(); break;
+        case StatusCode::DataTxdNack:
+        case StatusCode::LastDataTxdAck: break;
+        case StatusCode::BusError: control |= twsto; break; // Release the lines
+        default: break;
+        }
+
+        sfr8(TWCR_addr()) = control;
+
+        if (commit) {
+            const uint8_t count = writeCount;
+            writeCount = 0;
+            if (commitFunc != nullptr) commitFunc(commitData, writeFirst, count);
+        }
+    }
+
+private:
+    // Status codes of the slave receiver and transmitter modes, bits 7-3 of TWSR
+    struct StatusCode {
+        static constexpr uint8_t BusError = 0x00;
+        static constexpr uint8_t WriteAddressAck = 0x60 >> 3;
+        static constexpr uint8_t ArbitrationLostWriteAddress = 0x68 >> 3;
+        static constexpr uint8_t GeneralCallAck = 0x70 >> 3;
+        static constexpr uint8_t ArbitrationLostGeneralCall = 0x78 >> 3;
+        static constexpr uint8_t DataRxdAck = 0x80 >> 3;
+        static constexpr uint8_t DataRxdNack = 0x88 >> 3;
+        static constexpr uint8_t GeneralCallDataRxdAck = 0x90 >> 3;
+        static constexpr uint8_t GeneralCallDataRxdNack = 0x98 >> 3;
+        static constexpr uint8_t StopOrRepeatedStart = 0xA0 >> 3;
+        static constexpr uint8_t ReadAddressAck = 0xA8 >> 3;
+        static constexpr uint8_t ArbitrationLostReadAddress = 0xB0 >> 3;
+        static constexpr uint8_t DataTxdAck = 0xB8 >> 3;
+        static constexpr uint8_t DataTxdNack = 0xC0 >> 3;
+        static constexpr uint8_t LastDataTxdAck = 0xC8 >> 3;
+    };
+
+    static constexpr uint8_t twint = 1 << 7;
+    static constexpr uint8_t twea = 1 << 6;
+    static constexpr uint8_t twsto = 1 << 4;
+    static constexpr uint8_t twen = 1 << 2;
+    static constexpr uint8_t twie = 1 << 0;
+
+    // Clear the flag and acknowledge the next address or data byte
+    static constexpr uint8_t listen = twint | twea | twen | twie;
+
+    volatile uint8_t *registers {nullptr};
+    uint8_t           size {0};
+    uint8_t           firstWritable {0};
+    volatile uint8_t  pointer {0};
+    volatile uint8_t  addressed {0};
+    bool              expectPointer {false};
+    uint8_t           writeFirst {0};
+    uint8_t           writeCount {0};
+    CommitFunc        commitFunc {nullptr};
+    void             *commitData {nullptr};
+
+    auto isWritable(uint8_t reg) const -> bool { return reg >= firstWritable && reg < size; }
+
+    auto receive(uint8_t data) -> void
+    {
+        if (expectPointer) {
+            expectPointer = false;
+            pointer = data;
+            writeFirst = data;
+        } else if (isWritable(pointer)) {
+            registers[pointer] = data;
+            pointer = static_cast<uint8_t>(pointer + 1);
+            ++writeCount;
+        }
+    }
+
+    auto transmit() -> uint8_t
+    {
+        if (pointer >= size) return 0xFF;
+        const uint8_t data = registers[pointer];
+        pointer = static_cast<uint8_t>(pointer + 1);
+        return data;
+    }
+};
+
 } // namespace liquid
 
 #endif
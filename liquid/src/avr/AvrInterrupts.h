@@ -4,6 +4,8 @@
 namespace liquid
 {
 
+// Slots in irqHandlers, one per interrupt source. Sources must not share a slot,
+// installing a handler for one would replace the other's.
 struct Irq {
     static constexpr auto Timer0CompA = 1;
     static constexpr auto Timer1CompA = 2;
@@ -12,13 +14,32 @@ struct Irq {
     static constexpr auto Timer4CompA = 5;
     static constexpr auto Timer5CompA = 6;
 
-    static constexpr auto Pcint0 = 5;
-    static constexpr auto Pcint1 = 6;
-    static constexpr auto Pcint2 = 7;
+    // One per pin change interrupt bank, see GpioSpec::Pcint::getIrq()
+    static constexpr auto Pcint0 = 7;
+    static constexpr auto Pcint1 = 8;
+    static constexpr auto Pcint2 = 9;
 
-    static constexpr auto Twi = 8;
+    static constexpr auto Twi = 10;
 
-    static constexpr auto Max = 9;
+    // RX complete, data register empty and TX complete, for each USART
+    static constexpr auto Usart0Rx = 11;
+    static constexpr auto Usart0Udre = 12;
+    static constexpr auto Usart0Tx = 13;
+    static constexpr auto Usart1Rx = 14;
+    static constexpr auto Usart1Udre = 15;
+    static constexpr auto Usart1Tx = 16;
+    static constexpr auto Usart2Rx = 17;
+    static constexpr auto Usart2Udre = 18;
+    static constexpr auto Usart2Tx = 19;
+    static constexpr auto Usart3Rx = 20;
+    static constexpr auto Usart3Udre = 21;
+    static constexpr auto Usart3Tx = 22;
+
+    static constexpr auto Max = 23;
+
+    static constexpr auto usartRx(int usart) { return Usart0Rx + 3 * usart; }
+    static constexpr auto usartUdre(int usart) { return Usart0Udre + 3 * usart; }
+    static constexpr auto usartTx(int usart) { return Usart0Tx + 3 * usart; }
 };
 
 }
@@ -319,6 +319,13 @@ public:
 
     auto disablePeriodicInterrupt() -> void override { timer.TIMSK().OCIEA = 0; }
 
+    auto restartPeriodicInterrupt() -> void override
+    {
+        timer.TCNT() = 0;
+        sfr8(timer.config.tifrAddr) = 1 << 1; // Clear a pending OCFA
+        timer.TIMSK().OCIEA = 1;
+    }
+
     auto stop() -> void override { timer.TCCRB().CS = CS::None; }
 
 private:
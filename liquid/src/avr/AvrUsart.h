@@ -0,0 +1,868 @@
+#ifndef LIQUID_AVR_USART_H_
+#define LIQUID_AVR_USART_H_
+
+#include "../Interrupts.h"
+#include "../Reg.h"
+#include "../RingBuffer.h"
+#include "../Sys.h"
+#include "../Timer.h"
+#include "../Uart.h"
+#include "AvrInterrupts.h"
+#include "FlashStr.h"
+#include "Gpio.h"
+
+#include <assert.h>
+
+#ifndef LIQUID_USART_RX_BUFFER_SIZE
+#define LIQUID_USART_RX_BUFFER_SIZE 32
+#endif
+
+#ifndef LIQUID_USART_TX_BUFFER_SIZE
+#define LIQUID_USART_TX_BUFFER_SIZE 32
+#endif
+
+#ifndef LIQUID_USART_TX_QUEUE_SIZE
+#define LIQUID_USART_TX_QUEUE_SIZE 4
+#endif
+
+// Set to 0 to leave the statistics counters out of the interrupt handlers
+#ifndef LIQUID_USART_STATS
+#define LIQUID_USART_STATS 1
+#endif
+
+namespace liquid
+{
+
+static constexpr auto calcNormalModeUbrr(unsigned long fOsc, unsigned long baud) -> uint16_t
+{
+    return static_cast<uint16_t>((fOsc + 8 * baud) / (16 * baud) - 1);
+}
+
+static_assert(calcNormalModeUbrr(16000000, 9600) == 103);
+static_assert(calcNormalModeUbrr(16000000, 19200) == 51);
+static_assert(calcNormalModeUbrr(16000000, 115200) == 8);
+
+static constexpr auto calcDoubleSpeedUbrr(unsigned long fOsc, unsigned long baud) -> uint16_t
+{
+    return static_cast<uint16_t>((fOsc + 4 * baud) / (8 * baud) - 1);
+}
+
+static_assert(calcDoubleSpeedUbrr(16000000, 115200) == 16);
+static_assert(calcDoubleSpeedUbrr(16000000, 2000000) == 0);
+
+struct Usart::BaudConfig {
+    enum class Mode {
+        Normal,      // 16 samples per bit
+        DoubleSpeed, // 8 samples per bit, U2X set
+    };
+
+    bool     isValid;
+    Mode     mode;
+    uint16_t ubrr;
+    float    error {0.0f}; // Relative error of the achieved baud rate
+
+    constexpr bool operator==(const BaudConfig &other) const
+    {
+        return isValid == other.isValid && mode == other.mode && ubrr == other.ubrr;
+    };
+};
+
+/* -------------------------------------------------------------------------- */
+
+// USART number by register base: 0xC0, 0xC8, 0xD0, 0x130 (USART3 on the ATmega2560)
+constexpr auto usartIndex(uint16_t base) -> int
+{
+    return base < 0x100 ? (base - 0xC0) / 8 : 3;
+}
+
+static_assert(usartIndex(0xC0) == 0);
+static_assert(usartIndex(0xD0) == 2);
+static_assert(usartIndex(0x130) == 3);
+
+// USART register addresses, known at run time
+struct UsartAddr {
+    uint16_t base;
+
+    constexpr auto index() const -> int { return usartIndex(base); }
+    constexpr auto ucsrA() const -> uint16_t { return base; }
+    constexpr auto ucsrB() const -> uint16_t { return base + 1; }
+    constexpr auto ucsrC() const -> uint16_t { return base + 2; }
+    constexpr auto ubrr() const -> uint16_t { return base + 4; }
+    constexpr auto udr() const -> uint16_t { return base + 6; }
+};
+
+// USART register addresses, fixed at compile time
+template <uint16_t base> struct StaticUsartAddr {
+    static constexpr auto index() -> int { return usartIndex(base); }
+    static constexpr auto ucsrA() -> uint16_t { return base; }
+    static constexpr auto ucsrB() -> uint16_t { return base + 1; }
+    static constexpr auto ucsrC() -> uint16_t { return base + 2; }
+    static constexpr auto ubrr() -> uint16_t { return base + 4; }
+    static constexpr auto udr() -> uint16_t { return base + 6; }
+};
+
+/* -------------------------------------------------------------------------- */
+
+class AvrUsart
+{
+public:
+    using OverflowPolicy = Usart::OverflowPolicy;
+    using BaudConfig = Usart::BaudConfig;
+    using BaudMode = BaudConfig::Mode;
+    using RxFunc = Usart::RxFunc;
+    using Stats = Usart::Stats;
+
+    static constexpr uint8_t rxBufferSize = LIQUID_USART_RX_BUFFER_SIZE;
+    static constexpr uint8_t txBufferSize = LIQUID_USART_TX_BUFFER_SIZE;
+    static constexpr uint8_t txQueueSize = LIQUID_USART_TX_QUEUE_SIZE;
+    static constexpr bool    statsEnabled = LIQUID_USART_STATS;
+
+    // RX buffer fill levels for RTS flow control. The margin above the stop level
+    // absorbs the bytes the peer sends before it reacts.
+    static constexpr uint8_t rtsStopLevel = rxBufferSize - rxBufferSize / 4;
+    static constexpr uint8_t rtsResumeLevel = rxBufferSize / 4;
+
+    struct UsartMode {
+        static constexpr auto ASYNC_USART = 0;
+        static constexpr auto SYNC_USART = 1;
+        static constexpr auto SPI = 3;
+    };
+
+    struct ParityMode {
+        static constexpr auto DISABLED = 0;
+        static constexpr auto EVEN = 2;
+        static constexpr auto ODD = 3;
+    };
+
+    struct StopBitSelect {
+        static constexpr auto BIT_1 = 0;
+        static constexpr auto BIT_2 = 1;
+    };
+
+    struct CharSize {
+        static constexpr auto SIZE_5_BIT = 0;
+        static constexpr auto SIZE_6_BIT = 1;
+        static constexpr auto SIZE_7_BIT = 2;
+        static constexpr auto SIZE_8_BIT = 3;
+        static constexpr auto SIZE_9_BIT = 7;
+    };
+
+    // Receiver tolerance is about +/-2% for 8N1 frames. The default leaves some room
+    // for common clock/baud combinations, like 115200 at 16 MHz (2.1% in U2X mode).
+    static constexpr auto defaultMaxBaudError = 0.025f;
+
+    // The default maximum error as a fraction 1 / n, for the integer-only solver
+    static constexpr unsigned long maxBaudErrorDivider = 40;
+
+    static constexpr auto maxUbrr = 4095;
+
+    static constexpr auto noBroadcast = Usart::noBroadcast;
+
+    static constexpr auto getBaudRate(unsigned long fCpu, uint16_t ubrr, BaudMode mode) -> float
+    {
+        const auto divider = mode == BaudMode::Normal ? 16.0f : 8.0f;
+        return static_cast<float>(fCpu) / (divider * (static_cast<float>(ubrr) + 1.0f));
+    }
+
+    static constexpr auto configureBaud(unsigned long fCpu, BaudMode mode, unsigned long baud,
+                                        float maxError = defaultMaxBaudError) -> BaudConfig
+    {
+        const unsigned long divider = mode == BaudMode::Normal ? 16 : 8;
+        if (baud == 0 || fCpu < divider * baud / 2) {
+            return {false, mode, 0, 0.0f};
+        }
+
+        const auto ubrr = mode == BaudMode::Normal ? calcNormalModeUbrr(fCpu, baud)
+                                                   : calcDoubleSpeedUbrr(fCpu, baud);
+        const auto error = (getBaudRate(fCpu, ubrr, mode) - static_cast<float>(baud)) /
+                           static_cast<float>(baud);
+        const auto isValid = ubrr <= maxUbrr && error <= maxError && -error <= maxError;
+
+        return {isValid, mode, ubrr, error};
+    }
+
+    // Pick the mode with the lower baud rate error. Normal mode is preferred on a tie,
+    // since its receiver is more tolerant to noise and clock mismatch.
+    static constexpr auto configureBaud(unsigned long fCpu, unsigned long baud,
+                                        float maxError = defaultMaxBaudError) -> BaudConfig
+    {
+        const auto normal = configureBaud(fCpu, BaudMode::Normal, baud, maxError);
+        const auto doubleSpeed = configureBaud(fCpu, BaudMode::DoubleSpeed, baud, maxError);
+
+        if (!doubleSpeed.isValid) return normal;
+        if (!normal.isValid) return doubleSpeed;
+
+        const auto absError = [](float e) { return e < 0 ? -e : e; };
+        return absError(doubleSpeed.error) < absError(normal.error) ? doubleSpeed : normal;
+    }
+
+    // Compile-time checked variant
+    template <unsigned long fCpu, unsigned long baud> static constexpr auto configureBaud()
+    {
+        constexpr auto config = configureBaud(fCpu, baud);
+        static_assert(config.isValid, "Baud rate not achievable with this clock");
+        return config;
+    }
+
+    /*
+     * Integer-only counterpart of configureBaud(fCpu, baud), for rates only known
+     * at run time. It makes the same choice with the default maximum error, but
+     * doesn't pull in the soft-float code. The error field is left at 0.
+     */
+    static constexpr auto findBaud(unsigned long fCpu, unsigned long baud) -> BaudConfig
+    {
+        const auto normal = findBaud(fCpu, BaudMode::Normal, baud);
+        const auto doubleSpeed = findBaud(fCpu, BaudMode::DoubleSpeed, baud);
+
+        if (!doubleSpeed.isValid) return normal;
+        if (!normal.isValid) return doubleSpeed;
+
+        // Relative errors e / (baud * divisor), cross-multiplied. The baud rate cancels.
+        const auto lhs = static_cast<unsigned long long>(baudErrorTerm(fCpu, doubleSpeed, baud)) *
+                         baudDivisor(normal);
+        const auto rhs = static_cast<unsigned long long>(baudErrorTerm(fCpu, normal, baud)) *
+                         baudDivisor(doubleSpeed);
+        return lhs < rhs ? doubleSpeed : normal;
+    }
+
+    static constexpr auto findBaud(unsigned long fCpu, BaudMode mode, unsigned long baud)
+        -> BaudConfig
+    {
+        const unsigned long divider = mode == BaudMode::Normal ? 16 : 8;
+        if (baud == 0 || fCpu < divider * baud / 2) {
+            return {false, mode, 0};
+        }
+
+        const auto ubrr = mode == BaudMode::Normal ? calcNormalModeUbrr(fCpu, baud)
+                                                   : calcDoubleSpeedUbrr(fCpu, baud);
+        const BaudConfig config {true, mode, ubrr};
+
+        // |error| <= 1 / maxBaudErrorDivider
+        const auto error = baudErrorTerm(fCpu, config, baud);
+        const auto isValid =
+            ubrr <= maxUbrr && error * maxBaudErrorDivider <= baud * baudDivisor(config);
+
+        return {isValid, mode, ubrr};
+    }
+
+private:
+    // Clock cycles per bit
+    static constexpr auto baudDivisor(const BaudConfig &config) -> unsigned long
+    {
+        return (config.mode == BaudMode::Normal ? 16ul : 8ul) * (config.ubrr + 1ul);
+    }
+
+    // The relative error of the achieved baud rate is this over baud * baudDivisor()
+    static constexpr auto baudErrorTerm(unsigned long fCpu, const BaudConfig &config,
+                                        unsigned long baud) -> unsigned long
+    {
+        const auto cycles = baud * baudDivisor(config);
+        return fCpu > cycles ? fCpu - cycles : cycles - fCpu;
+    }
+};
+
+static_assert(1.0f / AvrUsart::maxBaudErrorDivider == AvrUsart::defaultMaxBaudError);
+
+/* -------------------------------------------------------------------------- */
+
+// USART driver. The register addresses come from Addr, so with StaticUsartAddr
+// all register accesses compile to direct loads and stores.
+template <class Addr> class BasicUsart : public AvrUsart, private Addr
+{
+public:
+    constexpr explicit BasicUsart(const Addr &addr = Addr {}) : Addr(addr) {}
+
+    constexpr auto RXC() const { return RegBits<7>(this->ucsrA()); }
+    constexpr auto TXC() const { return RegBits<6>(this->ucsrA()); }
+    constexpr auto UDRE() const { return RegBits<5>(this->ucsrA()); }
+    constexpr auto FE() const { return RegBits<4>(this->ucsrA()); }
+    constexpr auto DOR() const { return RegBits<3>(this->ucsrA()); }
+    constexpr auto UPE() const { return RegBits<2>(this->ucsrA()); }
+    constexpr auto U2X() const { return RegBits<1>(this->ucsrA()); }
+    constexpr auto MPCM() const { return RegBits<0>(this->ucsrA()); }
+
+    constexpr auto RXCIE() const { return RegBits<7>(this->ucsrB()); }
+    constexpr auto TXCIE() const { return RegBits<6>(this->ucsrB()); }
+    constexpr auto UDRIE() const { return RegBits<5>(this->ucsrB()); }
+    constexpr auto RXEN() const { return RegBits<4>(this->ucsrB()); }
+    constexpr auto TXEN() const { return RegBits<3>(this->ucsrB()); }
+    constexpr auto UCSZ2() const { return RegBits<2>(this->ucsrB()); }
+    constexpr auto RXB8() const { return RegBits<1>(this->ucsrB()); }
+    constexpr auto TXB8() const { return RegBits<0>(this->ucsrB()); }
+
+    constexpr auto UMSEL() const { return RegBits<6, 2>(this->ucsrC()); }
+    constexpr auto UPM() const { return RegBits<4, 2>(this->ucsrC()); }
+    constexpr auto USBS() const { return RegBits<3>(this->ucsrC()); }
+    constexpr auto UCSZ10() const { return RegBits<1, 2>(this->ucsrC()); }
+    constexpr auto UDORD() const { return RegBits<2>(this->ucsrC()); }
+    constexpr auto UCPHA() const { return RegBits<1>(this->ucsrC()); }
+    constexpr auto UCPOL() const { return RegBits<0>(this->ucsrC()); }
+
+    // An invalid configuration is not applied and returns false
+    auto apply(const BaudConfig &config) -> bool
+    {
+        if (!config.isValid) return false;
+
+        U2X() = config.mode == BaudMode::DoubleSpeed;
+        sfr16(this->ubrr()) = config.ubrr;
+        return true;
+    }
+
+    // Integer-only, see findBaud(). Prefer configureBaud<>() for a fixed rate.
+    auto setBaud(unsigned long fCpu, unsigned long baud) -> bool
+    {
+        return apply(findBaud(fCpu, baud));
+    }
+
+    /*
+     * Also installs the interrupt handlers, the object must not move afterwards.
+     * With an invalid configuration the USART is left untouched and it returns
+     * false.
+     */
+    auto setupUart(const BaudConfig &config) -> bool
+    {
+        if (!config.isValid) return false;
+
+        attachInterrupts();
+        apply(config);
+        UCSZ10() = CharSize::SIZE_8_BIT;
+        RXCIE() = 1;
+        RXEN() = 1;
+        TXEN() = 1;
+        return true;
+    }
+
+    auto setupUart(unsigned long fCpu, unsigned long baud) -> bool
+    {
+        return setupUart(findBaud(fCpu, baud));
+    }
+
+    // Each USART has its own vectors, so the handlers go straight to this instance
+    auto attachInterrupts() -> void
+    {
+        const auto usart = this->index();
+        installIrqHandler(Irq::usartRx(usart),
+                          IrqHandler::callMemberFunc<BasicUsart, &BasicUsart::rxIsr>(this));
+        installIrqHandler(Irq::usartUdre(usart),
+                          IrqHandler::callMemberFunc<BasicUsart, &BasicUsart::isr>(this));
+        installIrqHandler(Irq::usartTx(usart),
+                          IrqHandler::callMemberFunc<BasicUsart, &BasicUsart::txIsr>(this));
+    }
+
+    // Called from the interrupt context each time the transmitter goes idle,
+    // i.e. the last frame was shifted out and no new data is waiting.
+    auto setTxCompleteHandler(const IrqHandler &handler)
+    {
+        txCompleteHandler = handler;
+        updateTxCompleteInterrupt();
+    }
+
+    /*
+     * RS-485 half duplex: the transceiver's driver enable pin goes high before the
+     * first byte and low from the TX Complete interrupt, right after the last stop
+     * bit. The pin must already be configured as an output.
+     */
+    auto enableRs485(Gpio &driverEnable) -> void
+    {
+        NoInterruptsGuard guard;
+        dePin = &driverEnable;
+        guardTimer = nullptr;
+        dePin->setLow();
+        deActive = false;
+        updateTxCompleteInterrupt();
+    }
+
+    // As above, with the driver kept enabled for guardTime seconds after the last byte
+    auto enableRs485(Gpio &driverEnable, Timer &timer, unsigned long fCpu, float guardTime)
+        -> bool
+    {
+        const auto handler = IrqHandler::callMemberFunc<BasicUsart, &BasicUsart::guardIsr>(this);
+        if (!timer.enablePeriodicInterrupt(fCpu, 1.0f / guardTime, handler)) return false;
+        timer.disablePeriodicInterrupt();
+
+        enableRs485(driverEnable);
+        guardTimer = &timer;
+        return true;
+    }
+
+    /*
+     * RTS/CTS hardware flow control, both active low. RTS goes high when the RX
+     * buffer fills up to rtsStopLevel and low again once the application has read
+     * it down to rtsResumeLevel. A high CTS pauses the transmitter from the pin
+     * change interrupt, which this installs for the whole PCINT bank of the CTS pin.
+     *
+     * RTS must be configured as an output and CTS as an input.
+     */
+    auto enableFlowControl(Gpio &rts, Gpio &cts) -> void
+    {
+        assert(isValidIrq(cts.getIrq()));
+
+        NoInterruptsGuard guard;
+        rtsPin = &rts;
+        ctsPin = &cts;
+        rtsStopped = rxBuffer.size() >= rtsStopLevel;
+        rtsPin->set(rtsStopped);
+
+        installIrqHandler(cts.getIrq(),
+                          IrqHandler::callMemberFunc<BasicUsart, &BasicUsart::ctsIsr>(this));
+        cts.enableInterrupt();
+        ctsIsr();
+    }
+
+    auto disableFlowControl() -> void
+    {
+        NoInterruptsGuard guard;
+        if (ctsPin != nullptr) ctsPin->disableInterrupt();
+        if (rtsPin != nullptr) rtsPin->setLow();
+        rtsPin = nullptr;
+        ctsPin = nullptr;
+        if (!txQueue.isEmpty()) UDRIE() = 1;
+    }
+
+    auto disableRs485() -> void
+    {
+        NoInterruptsGuard guard;
+        if (guardTimer != nullptr) guardTimer->disablePeriodicInterrupt();
+        dePin = nullptr;
+        guardTimer = nullptr;
+        updateTxCompleteInterrupt();
+    }
+
+    // Single bytes are copied to the TX buffer. When it is full, the overflow policy applies.
+    auto tx(uint8_t data) { tx(data, overflowPolicy); }
+
+    // As above, with the policy given for this byte, e.g. Block for framing bytes
+    auto tx(uint8_t data, OverflowPolicy policy)
+    {
+        if (!txBuffer.push(data)) {
+            switch (policy) {
+            case OverflowPolicy::Block: waitForTx([&] { return txBuffer.push(data); }); break;
+            case OverflowPolicy::Drop: ++droppedBytes; return;
+            case OverflowPolicy::OverwriteOldest:
+                discardOldestBufferedByte();
+                txBuffer.push(data);
+                break;
+            }
+        }
+        if constexpr (statsEnabled) updateHighWater(stats.txHighWater, txBuffer.size());
+        queueBufferedBytes(1);
+    }
+
+    // The data is not copied, it must stay valid until onComplete is called
+    // (from the interrupt context) after the last byte was handed to the hardware.
+    auto tx(const uint8_t *data, int length, const IrqHandler &onComplete = {nullptr, nullptr})
+    {
+        if (length <= 0) return;
+
+        waitForTx(
+            [&] { return txQueue.push({data, static_cast<uint16_t>(length), false, onComplete}); });
+        startTransmitter();
+    }
+
+    // Streamed from program memory by the UDRE interrupt, without a copy in SRAM
+    auto tx(const FlashStr &str, const IrqHandler &onComplete = {nullptr, nullptr})
+    {
+        const auto length = str.length();
+        if (length == 0) return;
+
+        const auto *data = reinterpret_cast<const uint8_t *>(str.get());
+        waitForTx(
+            [&] { return txQueue.push({data, static_cast<uint16_t>(length), true, onComplete}); });
+        startTransmitter();
+    }
+
+    // Wait until all queued data has been handed to the hardware
+    auto flush()
+    {
+        waitForTx([&] { return txQueue.isEmpty(); });
+    }
+
+    auto setOverflowPolicy(OverflowPolicy policy) { overflowPolicy = policy; }
+
+    auto getDroppedBytes() const -> unsigned int { return droppedBytes; }
+
+    // Consistent copy of the counters, all zero with LIQUID_USART_STATS=0
+    auto getStats() const -> Stats
+    {
+        NoInterruptsGuard guard;
+        return stats;
+    }
+
+    auto resetStats() -> void
+    {
+        NoInterruptsGuard guard;
+        stats = {};
+    }
+
+    // Sleeps until a byte is received
+    auto rx() -> uint8_t
+    {
+        uint8_t data;
+        Sys::waitUntil([&] { return rxBuffer.pop(data); });
+        if (rtsPin != nullptr) resumeRts();
+        return data;
+    }
+
+    auto isRxReady() const -> bool
+    {
+        return !rxBuffer.isEmpty();
+    }
+
+    auto available() const -> int
+    {
+        return rxBuffer.size();
+    }
+
+    auto read(uint8_t *data, int length) -> int
+    {
+        int n = 0;
+        while (n < length && rxBuffer.pop(data[n]))
+            ++n;
+        if (rtsPin != nullptr) resumeRts();
+        return n;
+    }
+
+    auto peek() const -> int
+    {
+        uint8_t data;
+        return rxBuffer.peek(data) ? data : -1;
+    }
+
+    // Blocks until CR or LF. At most size - 1 characters are stored, the rest of
+    // the line is discarded. See LineAssembler for a non-blocking alternative.
+    auto readLine(uint8_t *rxbuf, int size) -> int
+    {
+        int length = 0;
+        while (true) {
+            const uint8_t ch = rx();
+            if (ch == '\n' || ch == '\r') break;
+            if (length < size - 1) rxbuf[length++] = ch;
+        }
+        if (size > 0) rxbuf[length] = 0;
+        return length;
+    }
+
+    /*
+     * Multi-processor communication mode: 9-bit frames, with the 9th bit set for
+     * address frames. With an own address, the node listens to data frames only
+     * after an address frame with its own (or the broadcast) address. MPCM makes
+     * the hardware discard data frames for other nodes without raising RXC.
+     *
+     * Without an address (bus master), all data frames are received.
+     */
+    auto enableMultiprocessorMode(uint8_t address, int broadcast = noBroadcast) -> void
+    {
+        NoInterruptsGuard guard;
+        setNineBitFrames();
+        ownAddress = address;
+        broadcastAddress = broadcast;
+        filterAddress = true;
+        addressed = false;
+        MPCM() = 1;
+    }
+
+    auto enableMultiprocessorMode() -> void
+    {
+        NoInterruptsGuard guard;
+        setNineBitFrames();
+        filterAddress = false;
+        addressed = true;
+        MPCM() = 0;
+    }
+
+    auto disableMultiprocessorMode() -> void
+    {
+        NoInterruptsGuard guard;
+        multiprocessor = false;
+        addressed = true;
+        MPCM() = 0;
+        UCSZ2() = 0;
+    }
+
+    // Queued data is sent first. Blocks until the address frame is in the shift register.
+    auto sendAddress(uint8_t address) -> void
+    {
+        flush();
+        if (dePin != nullptr) enableDriver();
+        while (!UDRE())
+            ;
+        TXB8() = 1;
+        sfr8(this->udr()) = address;
+        while (!UDRE())
+            ;
+        TXB8() = 0;
+    }
+
+    // Whether the last address frame selected this node
+    auto isAddressed() const -> bool { return addressed; }
+
+    // Received bytes go to func instead of the RX buffer. Pass nullptr to restore
+    // buffering.
+    auto setRxHandler(RxFunc func, void *data) -> void
+    {
+        NoInterruptsGuard guard;
+        rxFunc = func;
+        rxData = data;
+    }
+
+    inline void isr()
+    {
+        if constexpr (statsEnabled) ++stats.udreIsrCount;
+
+        auto *request = txQueue.front();
+        while (request != nullptr && request->length == 0) {
+            // Emptied by discardOldestBufferedByte()
+            txQueue.drop();
+            request = txQueue.front();
+        }
+        if (request == nullptr) {
+            UDRIE() = 0;
+            return;
+        }
+
+        uint8_t data = 0;
+        if (request->inFlash) {
+            data = pgm_read_byte(request->data++);
+        } else if (request->data != nullptr) {
+            data = *request->data++;
+        } else {
+            txBuffer.pop(data);
+        }
+        sfr8(this->udr()) = data;
+        if constexpr (statsEnabled) ++stats.bytesSent;
+
+        if (--request->length == 0) {
+            const auto onComplete = request->onComplete;
+            txQueue.drop();
+            if (onComplete.func != nullptr) onComplete();
+        }
+    }
+
+    inline void rxIsr()
+    {
+        if constexpr (statsEnabled) {
+            // The error flags belong to the frame in UDR, read them first
+            const uint8_t status = sfr8(this->ucsrA());
+            ++stats.rxIsrCount;
+            if (status & (1 << 4)) ++stats.framingErrors;
+            if (status & (1 << 3)) ++stats.overruns;
+            if (status & (1 << 2)) ++stats.parityErrors;
+        }
+
+        if (multiprocessor && RXB8()) {
+            // Address frame, RXB8 must be read before UDR
+            const uint8_t address = sfr8(this->udr());
+            if (filterAddress) {
+                addressed = address == ownAddress || address == broadcastAddress;
+                MPCM() = !addressed;
+            }
+            return;
+        }
+
+        // Reading UDR clears RXC. When the buffer is full, the byte is lost.
+        const uint8_t data = sfr8(this->udr());
+        if (!addressed) return;
+
+        if constexpr (statsEnabled) ++stats.bytesReceived;
+
+        if (rxFunc != nullptr) {
+            rxFunc(rxData, data);
+        } else if (rxBuffer.push(data)) {
+            if constexpr (statsEnabled) updateHighWater(stats.rxHighWater, rxBuffer.size());
+            if (rtsPin != nullptr && rxBuffer.size() >= rtsStopLevel) {
+                rtsPin->setHigh();
+                rtsStopped = true;
+            }
+        } else {
+            if constexpr (statsEnabled) ++stats.rxDropped;
+        }
+    }
+
+    inline void txIsr()
+    {
+        // TXC is cleared by the hardware when the interrupt is executed
+        if constexpr (statsEnabled) ++stats.txIsrCount;
+
+        if (dePin != nullptr && txQueue.isEmpty()) {
+            if (guardTimer != nullptr) {
+                guardTimer->restartPeriodicInterrupt();
+            } else {
+                disableDriver();
+            }
+        }
+        if (txCompleteHandler.func != nullptr) txCompleteHandler();
+    }
+
+    // CTS pin change
+    inline void ctsIsr()
+    {
+        if (ctsPin->get()) {
+            UDRIE() = 0;
+        } else if (!txQueue.isEmpty()) {
+            UDRIE() = 1;
+        }
+    }
+
+    inline void guardIsr()
+    {
+        guardTimer->disablePeriodicInterrupt();
+        if (txQueue.isEmpty()) disableDriver();
+    }
+
+private:
+    // A chunk of outgoing data. Requests without a data pointer take
+    // their bytes from txBuffer.
+    struct TxRequest {
+        const uint8_t *data;
+        uint16_t       length;
+        bool           inFlash; // data points to program memory
+        IrqHandler     onComplete;
+    };
+
+    RingBuffer<uint8_t, rxBufferSize>  rxBuffer;
+    RingBuffer<uint8_t, txBufferSize>  txBuffer;
+    RingBuffer<TxRequest, txQueueSize> txQueue;
+
+    OverflowPolicy overflowPolicy = OverflowPolicy::Block;
+    unsigned int   droppedBytes = 0;
+    IrqHandler     txCompleteHandler {nullptr, nullptr};
+    RxFunc         rxFunc = nullptr;
+    void          *rxData = nullptr;
+
+    Stats stats {};
+
+    Gpio         *dePin = nullptr;
+    Timer        *guardTimer = nullptr;
+    volatile bool deActive = false;
+
+    Gpio         *rtsPin = nullptr;
+    Gpio         *ctsPin = nullptr;
+    volatile bool rtsStopped = false;
+
+    bool          multiprocessor = false;
+    bool          filterAddress = false;
+    volatile bool addressed = true;
+    uint8_t       ownAddress = 0;
+    int           broadcastAddress = noBroadcast;
+
+    static auto updateHighWater(uint8_t &highWater, uint8_t level) -> void
+    {
+        if (level > highWater) highWater = level;
+    }
+
+    auto setNineBitFrames() -> void
+    {
+        multiprocessor = true;
+        UCSZ2() = 1;
+        UCSZ10() = CharSize::SIZE_9_BIT & 0x03;
+        TXB8() = 0;
+    }
+
+    auto queueBufferedBytes(uint16_t count) -> void
+    {
+        waitForTx([&] {
+            NoInterruptsGuard guard;
+
+            // Consecutive buffered bytes share one request
+            auto *last = txQueue.back();
+            if (last != nullptr && last->data == nullptr) {
+                last->length = static_cast<uint16_t>(last->length + count);
+                return true;
+            }
+            return txQueue.push({nullptr, count, false, {nullptr, nullptr}});
+        });
+        startTransmitter();
+    }
+
+    /*
+     * The UDRE interrupt makes room in the buffers. With the interrupts disabled,
+     * e.g. when printing from an interrupt handler, it can't run, so its work is
+     * done here each time the data register is empty (and CTS allows it).
+     */
+    template <class Done> auto waitForTx(Done done) -> void
+    {
+        if (Sys::areInterruptsEnabled()) {
+            Sys::waitUntil(done);
+            return;
+        }
+
+        while (!done()) {
+            while (!UDRE() || (ctsPin != nullptr && ctsPin->get()))
+                ;
+            isr();
+        }
+    }
+
+    auto startTransmitter() -> void
+    {
+        if (dePin != nullptr) enableDriver();
+
+        // The CTS interrupt resumes when the peer is ready again
+        NoInterruptsGuard guard;
+        if (ctsPin == nullptr || !ctsPin->get()) UDRIE() = 1;
+    }
+
+    auto resumeRts() -> void
+    {
+        NoInterruptsGuard guard;
+        if (rtsStopped && rxBuffer.size() <= rtsResumeLevel) {
+            rtsPin->setLow();
+            rtsStopped = false;
+        }
+    }
+
+    auto enableDriver() -> void
+    {
+        NoInterruptsGuard guard;
+        if (guardTimer != nullptr) guardTimer->disablePeriodicInterrupt();
+        if (deActive) return;
+
+        // TXC may still be set from the previous transmission
+        clearTxComplete();
+        dePin->setHigh();
+        deActive = true;
+    }
+
+    auto disableDriver() -> void
+    {
+        dePin->setLow();
+        deActive = false;
+    }
+
+    // TXC is cleared by writing 1. FE, DOR and UPE must be written as 0.
+    auto clearTxComplete() -> void
+    {
+        auto &ucsrA = sfr8(this->ucsrA());
+        ucsrA = static_cast<uint8_t>((ucsrA & ((1 << 1) | (1 << 0))) | (1 << 6));
+    }
+
+    auto updateTxCompleteInterrupt() -> void
+    {
+        TXCIE() = txCompleteHandler.func != nullptr || dePin != nullptr;
+    }
+
+    auto discardOldestBufferedByte() -> void
+    {
+        NoInterruptsGuard guard;
+
+        // The oldest buffered byte belongs to the first request without a data pointer
+        for (uint8_t i = 0; i < txQueueSize; ++i) {
+            auto *request = txQueue.at(i);
+            if (request == nullptr) break;
+
+            if (request->data == nullptr && request->length > 0) {
+                uint8_t discarded;
+                txBuffer.pop(discarded);
+                --request->length;
+                ++droppedBytes;
+                break;
+            }
+        }
+    }
+};
+
+template <uint16_t base> using UsartT = BasicUsart<StaticUsartAddr<base>>;
+
+} // namespace liquid
+
+#endif
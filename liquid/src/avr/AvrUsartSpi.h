@@ -0,0 +1,210 @@
+#ifndef LIQUID_AVR_USART_SPI_H_
+#define LIQUID_AVR_USART_SPI_H_
+
+#include "AvrUsart.h"
+
+namespace liquid
+{
+
+class AvrUsartSpi
+{
+public:
+    enum class BitOrder { MsbFirst, LsbFirst };
+
+    struct ClockConfig {
+        bool          isValid;
+        uint16_t      ubrr;
+        unsigned long frequency; // Actual SCK frequency
+    };
+
+    // Byte sent when a transfer has no TX data
+    static constexpr uint8_t fill = 0xFF;
+
+    // The fastest SCK not above fSck. fCpu / 2 is the upper limit.
+    static constexpr auto configureClock(unsigned long fCpu, unsigned long fSck) -> ClockConfig
+    {
+        if (fSck == 0) return {false, 0, 0};
+
+        const auto ubrr = (fCpu + 2 * fSck - 1) / (2 * fSck) - 1;
+        if (ubrr > AvrUsart::maxUbrr) return {false, 0, 0};
+
+        return {true, static_cast<uint16_t>(ubrr), fCpu / (2 * (ubrr + 1))};
+    }
+
+    template <unsigned long fCpu, unsigned long fSck> static constexpr auto configureClock()
+    {
+        constexpr auto config = configureClock(fCpu, fSck);
+        static_assert(config.isValid, "SCK frequency not achievable with this clock");
+        return config;
+    }
+};
+
+static_assert(AvrUsartSpi::configureClock(16000000, 8000000).ubrr == 0);
+static_assert(AvrUsartSpi::configureClock(16000000, 3000000).frequency == 2666666);
+static_assert(AvrUsartSpi::configureClock(16000000, 1000000).ubrr == 7);
+
+/*
+ * USART in Master SPI Mode (MSPIM).
+ *
+ * The transmitter is double buffered, so keeping a second byte in UDR lets
+ * consecutive bytes go out back to back, at up to fCpu / 2.
+ *
+ * The XCK pin must be configured as an output before setup(), it becomes SCK.
+ * TXD is MOSI and RXD is MISO, chip selects are up to the user.
+ */
+template <class Addr> class BasicUsartSpi : public AvrUsartSpi, private Addr
+{
+public:
+    constexpr explicit BasicUsartSpi(const Addr &addr = Addr {}) : Addr(addr) {}
+
+    constexpr auto RXC() const { return RegBits<7>(this->ucsrA()); }
+    constexpr auto TXC() const { return RegBits<6>(this->ucsrA()); }
+    constexpr auto UDRE() const { return RegBits<5>(this->ucsrA()); }
+
+    constexpr auto RXCIE() const { return RegBits<7>(this->ucsrB()); }
+    constexpr auto RXEN() const { return RegBits<4>(this->ucsrB()); }
+    constexpr auto TXEN() const { return RegBits<3>(this->ucsrB()); }
+
+    constexpr auto UMSEL() const { return RegBits<6, 2>(this->ucsrC()); }
+    constexpr auto UDORD() const { return RegBits<2>(this->ucsrC()); }
+    constexpr auto UCPHA() const { return RegBits<1>(this->ucsrC()); }
+    constexpr auto UCPOL() const { return RegBits<0>(this->ucsrC()); }
+
+    /*
+     * Also installs the interrupt handler, the object must not move afterwards.
+     * With an invalid clock the USART is left untouched and it returns false.
+     */
+    auto setup(const ClockConfig &clock, int mode = 0, BitOrder order = BitOrder::MsbFirst)
+        -> bool
+    {
+        if (!clock.isValid) return false;
+
+        attachInterrupts();
+
+        // UBRR must be zero when the transmitter is enabled
+        sfr16(this->ubrr()) = 0;
+        UMSEL() = AvrUsart::UsartMode::SPI;
+        setMode(mode, order);
+        RXEN() = 1;
+        TXEN() = 1;
+        sfr16(this->ubrr()) = clock.ubrr;
+        return true;
+    }
+
+    // SPI mode 0-3, e.g. to switch between devices on the same bus
+    auto setMode(int mode, BitOrder order = BitOrder::MsbFirst)
+    {
+        UCPOL() = (mode >> 1) & 1;
+        UCPHA() = mode & 1;
+        UDORD() = order == BitOrder::LsbFirst;
+    }
+
+    auto attachInterrupts() -> void
+    {
+        installIrqHandler(Irq::usartRx(this->index()),
+                          IrqHandler::callMemberFunc<BasicUsartSpi, &BasicUsartSpi::rxIsr>(this));
+    }
+
+    /*
+     * Full duplex transfer, busy waiting. Either buffer may be nullptr: without
+     * txData the fill byte is sent, without rxData the received bytes are dropped.
+     */
+    auto transfer(const uint8_t *txData, uint8_t *rxData, int length) -> void
+    {
+        int sent = 0;
+        int received = 0;
+
+        while (received < length) {
+            // One byte shifting out, one waiting in UDR
+            if (sent < length && sent - received < 2 && UDRE()) {
+                sfr8(this->udr()) = txData != nullptr ? txData[sent] : fill;
+                ++sent;
+            }
+            if (RXC()) {
+                const uint8_t data = sfr8(this->udr());
+                if (rxData != nullptr) rxData[received] = data;
+                ++received;
+            }
+        }
+    }
+
+    auto transfer(uint8_t data) -> uint8_t
+    {
+        uint8_t result;
+        transfer(&data, &result, 1);
+        return result;
+    }
+
+    /*
+     * Interrupt driven transfer. The buffers must stay valid until onComplete is
+     * called from the interrupt context. The RX Complete interrupt refills UDR,
+     * at high SCK rates the interrupt latency leaves gaps between bytes.
+     */
+    auto transferAsync(const uint8_t *txData, uint8_t *rxData, int length,
+                       const IrqHandler &onComplete) -> void
+    {
+        Sys::waitUntil([&] { return !busy; });
+
+        if (length <= 0) {
+            if (onComplete.func != nullptr) onComplete();
+            return;
+        }
+
+        asyncTx = txData;
+        asyncRx = rxData;
+        asyncLength = length;
+        asyncSent = 0;
+        asyncReceived = 0;
+        asyncComplete = onComplete;
+        busy = true;
+
+        NoInterruptsGuard guard;
+        RXCIE() = 1;
+        writeNext();
+        if (length > 1) {
+            while (!UDRE())
+                ;
+            writeNext();
+        }
+    }
+
+    auto isBusy() const -> bool { return busy; }
+
+    inline void rxIsr()
+    {
+        const uint8_t data = sfr8(this->udr());
+        if (asyncRx != nullptr) asyncRx[asyncReceived] = data;
+        ++asyncReceived;
+
+        if (asyncSent < asyncLength) {
+            writeNext();
+        } else if (asyncReceived == asyncLength) {
+            RXCIE() = 0;
+            busy = false;
+            if (asyncComplete.func != nullptr) asyncComplete();
+        }
+    }
+
+private:
+    const uint8_t *asyncTx = nullptr;
+    uint8_t       *asyncRx = nullptr;
+    int            asyncLength = 0;
+    int            asyncSent = 0;
+    int            asyncReceived = 0;
+    IrqHandler     asyncComplete {nullptr, nullptr};
+    volatile bool  busy = false;
+
+    inline auto writeNext() -> void
+    {
+        sfr8(this->udr()) = asyncTx != nullptr ? asyncTx[asyncSent] : fill;
+        ++asyncSent;
+    }
+};
+
+using UsartSpi = BasicUsartSpi<UsartAddr>;
+
+template <uint16_t base> using UsartSpiT = BasicUsartSpi<StaticUsartAddr<base>>;
+
+} // namespace liquid
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef LIQUID_FLASH_STR_H_
+#define LIQUID_FLASH_STR_H_
+
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace liquid
+{
+
+/*
+ * A NUL terminated string in program memory. It is read with pgm_read_byte()
+ * (lpm), and never copied to SRAM.
+ */
+class FlashStr
+{
+public:
+    constexpr explicit FlashStr(const char *str_) : str(str_) {}
+
+    // Program memory address, e.g. for printf_P("%S") or fputs_P()
+    constexpr auto get() const -> const char * { return str; }
+
+    auto length() const -> size_t { return strlen_P(str); }
+
+    auto operator[](size_t i) const -> char
+    {
+        return static_cast<char>(pgm_read_byte(str + i));
+    }
+
+private:
+    const char *str;
+};
+
+} // namespace liquid
+
+// String literal placed in program memory
+#define FLASH_STR(s) (::liquid::FlashStr(PSTR(s)))
+
+// Constant data placed in program memory, for the portable headers
+#define FLASH_DATA PROGMEM
+
+#endif
@@ -2,7 +2,11 @@
 #define LIQUID_GPIO2_H_
 
 #include "../Interrupts.h"
+#include "../Reg.h"
 #include "AvrInterrupts.h"
+#include "TimerDefs.h"
+
+#include <assert.h>
 
 namespace liquid
 {
@@ -131,6 +135,9 @@ public:
         writeByMask(spec.regs.pcmsk, spec.pcint.pcmskMask, 0);
     }
 
+    // Pin change interrupt of the bank, shared with the other pins in it
+    auto getIrq() const -> int { return spec.getIrq(); }
+
 private:
     const GpioSpec     &spec;
     const volatile Sfr8 portReg;
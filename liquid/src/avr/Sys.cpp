@@ -9,6 +9,9 @@ static constexpr uint16_t SREG_addr = 0x5F;
 
 static constexpr RegBits<7> GIE(SREG_addr);
 
+static constexpr uint16_t SMCR_addr = 0x53;
+static constexpr uint8_t  SE = 1 << 0;
+
 unsigned int Sys::getFreeMemory()
 {
     char stack;
@@ -30,6 +33,14 @@ auto Sys::areInterruptsEnabled() -> bool
     return GIE;
 }
 
+auto Sys::sleepWithInterrupts(SleepMode mode) -> void
+{
+    // Sleep enabled only for the sleep instruction, as the data sheet recommends
+    sfr8(SMCR_addr) = static_cast<uint8_t>((static_cast<uint8_t>(mode) << 1) | SE);
+    __asm__ __volatile__("sei\n\tsleep" ::: "memory");
+    sfr8(SMCR_addr) = 0;
+}
+
 // -----------------------------------------------------------------------------
 
 NoInterruptsGuard::NoInterruptsGuard() : savedState(Sys::areInterruptsEnabled())
@@ -21,8 +21,9 @@ static int uart_getchar(FILE *stream)
 namespace liquid
 {
 
-void installAsStdStreams(Usart &uart)
+void installAsStdStreams(Usart &uart, Usart::OverflowPolicy policy)
 {
+    uart.setOverflowPolicy(policy);
     fdev_setup_stream(&console, uart_putchar, uart_getchar, _FDEV_SETUP_RW);
     fdev_set_udata(&console, &uart);
     stdout = &console;
@@ -30,14 +31,36 @@ void installAsStdStreams(Usart &uart)
     stdin = &console;
 }
 
-auto Usart::setBaud(unsigned long fCpu, unsigned long baud) -> void
+void flushStdStreams()
 {
-    impl->setBaud(fCpu, baud);
+    auto *uart = static_cast<liquid::Usart*>(fdev_get_udata(&console));
+    if (uart != nullptr) uart->flush();
 }
 
-auto Usart::setupUart(unsigned long fCpu, unsigned long baud) -> void
+void printFlash(const FlashStr &str)
 {
-    impl->setupUart(fCpu, baud);
+    auto *uart = static_cast<liquid::Usart*>(fdev_get_udata(&console));
+    if (uart != nullptr) uart->getImpl().tx(str);
+}
+
+auto Usart::setBaud(unsigned long fCpu, unsigned long baud) -> bool
+{
+    return impl->setBaud(fCpu, baud);
+}
+
+auto Usart::setupUart(unsigned long fCpu, unsigned long baud) -> bool
+{
+    return impl->setupUart(fCpu, baud);
+}
+
+auto Usart::setupUart(const BaudConfig &config) -> bool
+{
+    return impl->setupUart(config);
+}
+
+auto Usart::apply(const BaudConfig &config) -> bool
+{
+    return impl->apply(config);
 }
 
 auto Usart::tx(uint8_t data) -> void
@@ -45,11 +68,46 @@ auto Usart::tx(uint8_t data) -> void
     impl->tx(data);
 }
 
+auto Usart::tx(uint8_t data, OverflowPolicy policy) -> void
+{
+    impl->tx(data, policy);
+}
+
 auto Usart::tx(const void *data, int length) -> void
 {
     impl->tx(reinterpret_cast<const uint8_t*>(data), length);
 }
 
+auto Usart::tx(const void *data, int length, const IrqHandler &onComplete) -> void
+{
+    impl->tx(reinterpret_cast<const uint8_t*>(data), length, onComplete);
+}
+
+auto Usart::flush() -> void
+{
+    impl->flush();
+}
+
+auto Usart::setOverflowPolicy(OverflowPolicy policy) -> void
+{
+    impl->setOverflowPolicy(policy);
+}
+
+auto Usart::getDroppedBytes() const -> unsigned int
+{
+    return impl->getDroppedBytes();
+}
+
+auto Usart::getStats() const -> Stats
+{
+    return impl->getStats();
+}
+
+auto Usart::resetStats() -> void
+{
+    impl->resetStats();
+}
+
 auto Usart::rx() -> uint8_t
 {
     return impl->rx();
@@ -60,9 +118,80 @@ auto Usart::isRxReady() const -> bool
     return impl->isRxReady();
 }
 
+auto Usart::available() const -> int
+{
+    return impl->available();
+}
+
+auto Usart::read(void *data, int length) -> int
+{
+    return impl->read(reinterpret_cast<uint8_t*>(data), length);
+}
+
+auto Usart::peek() const -> int
+{
+    return impl->peek();
+}
+
 auto Usart::readLine(uint8_t *rxbuf, int size) -> int
 {
     return impl->readLine(rxbuf, size);
 }
 
+auto Usart::setRxHandler(RxFunc func, void *data) -> void
+{
+    impl->setRxHandler(func, data);
+}
+
+auto Usart::enableMultiprocessorMode(uint8_t address, int broadcast) -> void
+{
+    impl->enableMultiprocessorMode(address, broadcast);
+}
+
+auto Usart::enableMultiprocessorMode() -> void
+{
+    impl->enableMultiprocessorMode();
+}
+
+auto Usart::disableMultiprocessorMode() -> void
+{
+    impl->disableMultiprocessorMode();
+}
+
+auto Usart::sendAddress(uint8_t address) -> void
+{
+    impl->sendAddress(address);
+}
+
+auto Usart::isAddressed() const -> bool
+{
+    return impl->isAddressed();
+}
+
+auto Usart::enableRs485(Gpio &driverEnable) -> void
+{
+    impl->enableRs485(driverEnable);
+}
+
+auto Usart::enableRs485(Gpio &driverEnable, Timer &timer, unsigned long fCpu, float guardTime)
+    -> bool
+{
+    return impl->enableRs485(driverEnable, timer, fCpu, guardTime);
+}
+
+auto Usart::disableRs485() -> void
+{
+    impl->disableRs485();
+}
+
+auto Usart::enableFlowControl(Gpio &rts, Gpio &cts) -> void
+{
+    impl->enableFlowControl(rts, cts);
+}
+
+auto Usart::disableFlowControl() -> void
+{
+    impl->disableFlowControl();
+}
+
 } // namespace liquid
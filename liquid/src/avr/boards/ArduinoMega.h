@@ -5,6 +5,7 @@
 #include "../AvrInterrupts.h"
 #include "../AvrTimer16.h"
 #include "../AvrTimer8.h"
+#include "../AvrUsartSpi.h"
 #include "../Gpio.h"
 #include "../UartImpl.h"
 
@@ -239,6 +240,16 @@ public:
         static constexpr GpioSpec D53 = {portB, 0, {0, 0}};
 
         static constexpr auto BuiltInLed = D13;
+
+        // TWI pins, for bus recovery
+        static constexpr auto SDA = D20;
+        static constexpr auto SCL = D21;
+
+        // USART clock pins, for Master SPI Mode. Not routed to the board headers.
+        static constexpr GpioSpec XCK0 = {portE, 2};
+        static constexpr GpioSpec XCK1 = {portD, 5};
+        static constexpr GpioSpec XCK2 = {portH, 2};
+        static constexpr GpioSpec XCK3 = {portJ, 2, {11, 2}};
     };
 
     static auto makeGpio(const GpioSpec &spec) { return liquid::Gpio(spec, spec.pin); }
@@ -261,6 +272,24 @@ public:
     static auto makeAdc() -> Adc { return Adc {new Adc::Impl(0x78)}; }
 
     static auto makeUsart(int num) -> Usart { return Usart {new Usart::Impl(usartBase[num])}; }
+
+    // Facade over a statically allocated driver
+    template <int num> static auto makeUsart() -> Usart
+    {
+        static Usart::Impl impl {usartBase[num]};
+        return Usart {&impl};
+    }
+
+    // Driver with the register addresses resolved at compile time
+    template <int num> using StaticUsart = UsartT<usartBase[num]>;
+
+    // USART in Master SPI Mode, set the XCK pin as an output first
+    static auto makeUsartSpi(int num) -> UsartSpi
+    {
+        return UsartSpi {UsartAddr {usartBase[num]}};
+    }
+
+    template <int num> using StaticUsartSpi = UsartSpiT<usartBase[num]>;
 };
 
 } // namespace liquid
@@ -25,12 +25,12 @@ ISR(PCINT0_vect)
 
 ISR(PCINT1_vect)
 {
-    irqHandlers[Irq::Pcint0]();
+    irqHandlers[Irq::Pcint1]();
 }
 
 ISR(PCINT2_vect)
 {
-    irqHandlers[Irq::Pcint1]();
+    irqHandlers[Irq::Pcint2]();
 }
 
 ISR(TIMER1_COMPA_vect)
@@ -53,12 +53,70 @@ ISR(TIMER5_COMPA_vect)
     irqHandlers[Irq::Timer5CompA]();
 }
 
+ISR(USART0_RX_vect)
+{
+    irqHandlers[Irq::Usart0Rx]();
+}
+
+ISR(USART0_UDRE_vect)
+{
+    irqHandlers[Irq::Usart0Udre]();
+}
+
+ISR(USART0_TX_vect)
+{
+    irqHandlers[Irq::Usart0Tx]();
+}
+
+ISR(USART1_RX_vect)
+{
+    irqHandlers[Irq::Usart1Rx]();
+}
+
 ISR(USART1_UDRE_vect)
 {
-    callUsartIsr();
+    irqHandlers[Irq::Usart1Udre]();
+}
+
+ISR(USART1_TX_vect)
+{
+    irqHandlers[Irq::Usart1Tx]();
+}
+
+ISR(USART2_RX_vect)
+{
+    irqHandlers[Irq::Usart2Rx]();
+}
+
+ISR(USART2_UDRE_vect)
+{
+    irqHandlers[Irq::Usart2Udre]();
+}
+
+ISR(USART2_TX_vect)
+{
+    irqHandlers[Irq::Usart2Tx]();
+}
+
+ISR(USART3_RX_vect)
+{
+    irqHandlers[Irq::Usart3Rx]();
+}
+
+ISR(USART3_UDRE_vect)
+{
+    irqHandlers[Irq::Usart3Udre]();
+}
+
+ISR(USART3_TX_vect)
+{
+    irqHandlers[Irq::Usart3Tx]();
 }
 
 ISR(TWI_vect)
 {
     irqHandlers[Irq::Twi]();
 }
+
+// Only wakes the CPU from sleep, see AvrAdc
+EMPTY_INTERRUPT(ADC_vect);
@@ -5,6 +5,7 @@
 #include "../AvrInterrupts.h"
 #include "../AvrTimer16.h"
 #include "../AvrTimer8.h"
+#include "../AvrUsartSpi.h"
 #include "../UartImpl.h"
 
 #include "../Gpio.h"
@@ -77,6 +78,11 @@ public:
         static constexpr GpioSpec D7 = {portD, 7, {23, 7}};
 
         static constexpr auto BuiltInLed = D13;
+        static constexpr auto XCK0 = D4;
+
+        // TWI pins, for bus recovery
+        static constexpr auto SDA = A4;
+        static constexpr auto SCL = A5;
     };
 
     static constexpr AvrTimer8::Config timer8Config[] = {
@@ -124,6 +130,24 @@ public:
     static auto makeAdc() -> Adc { return Adc {new Adc::Impl(0x78)}; }
 
     static auto makeUsart(int num) -> Usart { return Usart {new Usart::Impl(usartBase[num])}; }
+
+    // Facade over a statically allocated driver
+    template <int num> static auto makeUsart() -> Usart
+    {
+        static Usart::Impl impl {usartBase[num]};
+        return Usart {&impl};
+    }
+
+    // Driver with the register addresses resolved at compile time
+    template <int num> using StaticUsart = UsartT<usartBase[num]>;
+
+    // USART in Master SPI Mode, set the XCK pin as an output first
+    static auto makeUsartSpi(int num) -> UsartSpi
+    {
+        return UsartSpi {UsartAddr {usartBase[num]}};
+    }
+
+    template <int num> using StaticUsartSpi = UsartSpiT<usartBase[num]>;
 };
 
 } // namespace liquid
@@ -25,12 +25,12 @@ ISR(PCINT0_vect)
 
 ISR(PCINT1_vect)
 {
-    irqHandlers[Irq::Pcint0]();
+    irqHandlers[Irq::Pcint1]();
 }
 
 ISR(PCINT2_vect)
 {
-    irqHandlers[Irq::Pcint1]();
+    irqHandlers[Irq::Pcint2]();
 }
 
 ISR(TIMER1_COMPA_vect)
@@ -43,12 +43,25 @@ ISR(TIMER0_COMPA_vect)
     irqHandlers[Irq::Timer0CompA]();
 }
 
+ISR(USART_RX_vect)
+{
+    irqHandlers[Irq::Usart0Rx]();
+}
+
 ISR(USART_UDRE_vect)
 {
-    callUsartIsr();
+    irqHandlers[Irq::Usart0Udre]();
+}
+
+ISR(USART_TX_vect)
+{
+    irqHandlers[Irq::Usart0Tx]();
 }
 
 ISR(TWI_vect)
 {
     irqHandlers[Irq::Twi]();
 }
+
+// Only wakes the CPU from sleep, see AvrAdc
+EMPTY_INTERRUPT(ADC_vect);
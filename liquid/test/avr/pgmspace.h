@@ -0,0 +1,18 @@
+// Host replacement for avr-libc's <avr/pgmspace.h>, program memory is plain memory.
+#ifndef MOCK_PGMSPACE_H_
+#define MOCK_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+
+inline auto strlen_P(const char *s) -> size_t
+{
+    return strlen(s);
+}
+
+#endif
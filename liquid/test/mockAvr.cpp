@@ -1,11 +1,16 @@
 #include "mockAvr.h"
+#include <AvrInterrupts.h>
+#include <Sys.h>
 #include <string.h>
 
 uint8_t mock_mem[1024] = {0};
 
+MockSleep mockSleep;
+
 auto mockMemReset() -> void
 {
     memset(mock_mem, 0, sizeof(mock_mem));
+    mockSleep = {};
 }
 
 auto memAt(uint16_t addr) -> int
@@ -18,13 +23,59 @@ auto writeMemAt(uint16_t addr) -> uint8_t &
     return mock_mem[addr];
 }
 
+auto hardwareClearsTwint() -> void
+{
+    writeMemAt(TwiRegs::TWCR) &= ~(1 << 7);
+}
+
 namespace liquid
 {
 
-struct IrqHandler;
+static bool mockInterruptsEnabled = false;
+
+auto Sys::enableInterrupts() -> void
+{
+    mockInterruptsEnabled = true;
+}
+
+auto Sys::disableInterrupts() -> void
+{
+    mockInterruptsEnabled = false;
+}
+
+auto Sys::areInterruptsEnabled() -> bool
+{
+    return mockInterruptsEnabled;
+}
+
+auto Sys::sleepWithInterrupts(SleepMode mode) -> void
+{
+    ++mockSleep.count;
+    mockSleep.lastMode = mode;
+    Sys::enableInterrupts();
+    if (mockSleep.wakeHandler.func != nullptr) mockSleep.wakeHandler();
+}
 
-auto installIrqHandler(int, const IrqHandler &) -> void
+NoInterruptsGuard::NoInterruptsGuard() : savedState(Sys::areInterruptsEnabled())
 {
+    Sys::disableInterrupts();
+}
+
+NoInterruptsGuard::~NoInterruptsGuard()
+{
+    if (savedState) Sys::enableInterrupts();
+}
+
+static IrqHandler mockIrqHandlers[Irq::Max] = {};
+
+auto installIrqHandler(int irq, const IrqHandler &handler) -> void
+{
+    if (irq >= 0 && irq < Irq::Max) mockIrqHandlers[irq] = handler;
 }
 
 } // namespace liquid
+
+auto mockIrqHandler(int irq) -> const liquid::IrqHandler &
+{
+    return liquid::mockIrqHandlers[irq];
+}
@@ -1,6 +1,8 @@
 #ifndef MOCKAVR_H_
 #define MOCKAVR_H_
 
+#include <Interrupts.h>
+#include <Sys.h>
 #include <stdint.h>
 
 static constexpr auto F_CPU = 16'000'000;
@@ -11,4 +13,46 @@ auto mockMemReset() -> void;
 auto memAt(uint16_t addr) -> int;
 auto writeMemAt(uint16_t addr) -> uint8_t &;
 
+// Last handler passed to installIrqHandler()
+auto mockIrqHandler(int irq) -> const liquid::IrqHandler &;
+
+// Sys::sleepWithInterrupts() calls wakeHandler, the interrupt that ends the sleep
+struct MockSleep {
+    int                    count = 0;
+    liquid::Sys::SleepMode lastMode = liquid::Sys::SleepMode::Idle;
+    liquid::IrqHandler     wakeHandler = {nullptr, nullptr};
+};
+
+extern MockSleep mockSleep;
+
+struct TwiRegs {
+    static constexpr auto TWBR = 0xB8;
+    static constexpr auto TWSR = 0xB9;
+    static constexpr auto TWAR = 0xBA;
+    static constexpr auto TWDR = 0xBB;
+    static constexpr auto TWCR = 0xBC;
+    static constexpr auto TWAMR = 0xBD;
+};
+
+struct Usart0Regs {
+    static constexpr auto UCSRA = 0xC0;
+    static constexpr auto UCSRB = 0xC1;
+    static constexpr auto UCSRC = 0xC2;
+    static constexpr auto UBRRL = 0xC4;
+    static constexpr auto UBRRH = 0xC5;
+    static constexpr auto UDR = 0xC6;
+};
+
+// Writing 1 to TWINT bit causes the hardware to clear this bit.
+// This function simulates the hardware clearing TWINT bit.
+auto hardwareClearsTwint() -> void;
+
+// Let an I2C controller handle one hardware event
+template <class Controller> auto twiEvent(Controller &dev, uint8_t twsr) -> void
+{
+    hardwareClearsTwint();
+    writeMemAt(TwiRegs::TWSR) = twsr;
+    dev.isr();
+}
+
 #endif
@@ -0,0 +1,254 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "mockAvr.h"
+#include <Async.h>
+#include <avr/AsyncI2c.h>
+#include <avr/UartImpl.h>
+
+#include <string.h>
+
+using namespace liquid;
+
+static auto tick(SysTimer &clock, int n) -> void
+{
+    for (int i = 0; i < n; ++i)
+        clock.isr();
+}
+
+static auto twice(int x) -> Task<int>
+{
+    co_return 2 * x;
+}
+
+static auto sum(int &result) -> Task<>
+{
+    const auto a = co_await twice(10);
+    const auto b = co_await twice(a);
+    result = a + b;
+}
+
+static auto wake(int &steps, unsigned long ticks) -> Task<>
+{
+    ++steps;
+    co_await sleepFor(ticks);
+    ++steps;
+    co_await sleepFor(ticks);
+    ++steps;
+}
+
+static auto readRegister(AsyncI2c &i2c, AvrI2c::Status &status, uint8_t &value) -> Task<>
+{
+    const uint8_t reg = 0x71;
+    status = co_await i2c.writeRead(0x38, &reg, 1, &value, 1);
+}
+
+static auto readCommand(AsyncUart<Usart::Impl> &uart, char *command, int &length) -> Task<>
+{
+    uint8_t line[8];
+    length = co_await uart.readLine(line, sizeof(line));
+    memcpy(command, line, sizeof(line));
+}
+
+static auto waitFor(const bool &flag, int &done) -> Task<>
+{
+    co_await until([&] { return flag; });
+    ++done;
+}
+
+TEST_CASE("Async - Nested tasks return values")
+{
+    SysTimer clock;
+    Executor executor {clock};
+    int      result = 0;
+
+    CHECK(executor.spawn(sum(result)));
+    CHECK(result == 0); // Starts from the executor
+
+    // The parent resumes after each child in a later round
+    while (executor.runOnce())
+        ;
+    CHECK(result == 60);
+    CHECK(FramePool::getFreeCount() == FramePool::count);
+}
+
+TEST_CASE("Async - Frames come from the static pool")
+{
+    SysTimer clock;
+    Executor executor {clock};
+    int      steps[FramePool::count + 1] = {};
+
+    for (int i = 0; i < FramePool::count; ++i)
+        CHECK(executor.spawn(wake(steps[i], 1)));
+    CHECK(FramePool::getFreeCount() == 0);
+
+    auto extra = wake(steps[FramePool::count], 1);
+    CHECK(extra.isValid() == false);
+    CHECK(executor.spawn(static_cast<Task<> &&>(extra)) == false);
+
+    for (int i = 0; i < 3; ++i) {
+        executor.runOnce();
+        tick(clock, 1);
+    }
+    executor.runOnce();
+    CHECK(steps[0] == 3);
+    CHECK(FramePool::getFreeCount() == FramePool::count);
+}
+
+TEST_CASE("Async - sleepFor")
+{
+    SysTimer clock;
+    Executor executor {clock};
+    int      steps = 0;
+
+    executor.spawn(wake(steps, 10));
+    executor.runOnce();
+    CHECK(steps == 1);
+
+    tick(clock, 9);
+    CHECK(executor.runOnce() == false);
+    CHECK(steps == 1);
+
+    tick(clock, 1);
+    CHECK(executor.runOnce());
+    CHECK(steps == 2);
+
+    tick(clock, 10);
+    executor.runOnce();
+    CHECK(steps == 3);
+}
+
+TEST_CASE("Async - until")
+{
+    SysTimer clock;
+    Executor executor {clock};
+    bool     flag = false;
+    int      done = 0;
+
+    executor.spawn(waitFor(flag, done));
+    executor.runOnce();
+    executor.runOnce();
+    CHECK(done == 0);
+
+    flag = true;
+    executor.runOnce();
+    CHECK(done == 1);
+}
+
+TEST_CASE("Async - I2C write then read resumes from the interrupt")
+{
+    mockMemReset();
+    SysTimer         clock;
+    Executor         executor {clock};
+    AvrI2cController bus;
+    AsyncI2c         i2c {bus};
+
+    auto    status = AvrI2c::Status::Unknown;
+    uint8_t value = 0;
+
+    executor.spawn(readRegister(i2c, status, value));
+    executor.runOnce();
+    CHECK(bus.getStatus() == AvrI2c::Status::InProgress);
+
+    twiEvent(bus, 0x08);
+    CHECK(memAt(TwiRegs::TWDR) == 0x70);
+    twiEvent(bus, 0x18);
+    CHECK(memAt(TwiRegs::TWDR) == 0x71);
+    twiEvent(bus, 0x28);
+    twiEvent(bus, 0x10);
+    twiEvent(bus, 0x40);
+    writeMemAt(TwiRegs::TWDR) = 0x1C;
+
+    // The STOP completes the transaction, the coroutine resumes from the executor
+    twiEvent(bus, 0x58);
+    CHECK(status == AvrI2c::Status::Unknown);
+    CHECK(executor.runOnce());
+    CHECK(status == AvrI2c::Status::Ok);
+    CHECK(value == 0x1C);
+}
+
+TEST_CASE("Async - I2C with the queue full waits on the executor")
+{
+    mockMemReset();
+    SysTimer         clock;
+    Executor         executor {clock};
+    AvrI2cController bus;
+    AsyncI2c         i2c {bus};
+
+    // One running, four queued
+    for (int i = 0; i < 5; ++i)
+        CHECK(bus.trySubmit(AvrI2c::Transaction::probe(0x40)));
+
+    auto    status = AvrI2c::Status::Unknown;
+    uint8_t value = 0;
+
+    executor.spawn(readRegister(i2c, status, value));
+    executor.runOnce();
+    CHECK(bus.getQueuedCount() == 4);
+
+    // Nothing freed, the submit is retried without resuming
+    CHECK_FALSE(executor.runOnce());
+    CHECK(bus.getQueuedCount() == 4);
+
+    // Without an acknowledge each probe is done after its address
+    twiEvent(bus, 0x08);
+    twiEvent(bus, 0x20);
+    CHECK(bus.getQueuedCount() == 3);
+    CHECK_FALSE(executor.runOnce());
+    CHECK(bus.getQueuedCount() == 4);
+
+    for (int i = 0; i < 4; ++i) {
+        twiEvent(bus, 0x08);
+        twiEvent(bus, 0x20);
+    }
+    CHECK(bus.getQueuedCount() == 0);
+    CHECK_FALSE(executor.runOnce());
+
+    twiEvent(bus, 0x08);
+    CHECK(memAt(TwiRegs::TWDR) == 0x70);
+    twiEvent(bus, 0x18);
+    twiEvent(bus, 0x28);
+    twiEvent(bus, 0x10);
+    twiEvent(bus, 0x40);
+    writeMemAt(TwiRegs::TWDR) = 0x1C;
+    twiEvent(bus, 0x58);
+    CHECK(status == AvrI2c::Status::Unknown);
+
+    // Resumed once, from the wait list
+    CHECK(executor.runOnce());
+    CHECK(status == AvrI2c::Status::Ok);
+    CHECK(value == 0x1C);
+    CHECK_FALSE(executor.runOnce());
+}
+
+TEST_CASE("Async - UART readLine")
+{
+    mockMemReset();
+    SysTimer               clock;
+    Executor               executor {clock};
+    Usart::Impl            dev(Usart0Regs::UCSRA);
+    AsyncUart<Usart::Impl> uart {dev};
+
+    char command[8] = {};
+    int  length = -1;
+
+    const auto receive = [&](const char *text) {
+        for (; *text != 0; ++text) {
+            writeMemAt(Usart0Regs::UDR) = static_cast<uint8_t>(*text);
+            dev.rxIsr();
+        }
+    };
+
+    receive("st");
+    executor.spawn(readCommand(uart, command, length));
+    executor.runOnce();
+    CHECK(length == -1);
+
+    receive("atus\r\n");
+    executor.runOnce();
+    executor.runOnce();
+    CHECK(length == 6);
+    CHECK(strcmp(command, "status") == 0);
+
+    // The LF is still buffered
+    CHECK(dev.available() == 1);
+}
@@ -0,0 +1,147 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <Format.h>
+#include <stdint.h>
+#include <string.h>
+
+using namespace liquid;
+
+namespace
+{
+
+struct Stored {
+    char buffer[64];
+};
+
+template <class Fmt, class... Args> auto formatted(Fmt fmt, const Args &...args) -> Stored
+{
+    Stored s {};
+    formatTo(s.buffer, sizeof(s.buffer), fmt, args...);
+    return s;
+}
+
+template <class Fmt> constexpr auto program(Fmt) { return FormatTraits<Fmt>::program; }
+
+} // namespace
+
+TEST_CASE("Format string is compiled to literal and field ops")
+{
+    constexpr auto p = program(FORMAT_STR("t={} ms {{{:04x}}}"));
+
+    static_assert(p.errorAt < 0);
+    static_assert(p.count == 5);
+    static_assert(p.fields == 2);
+
+    static_assert(!p.ops[0].isField && p.ops[0].begin == 0 && p.ops[0].length == 2);
+    static_assert(p.ops[1].isField && p.ops[1].field.width == 0);
+    static_assert(!p.ops[2].isField && p.ops[2].length == 5); // " ms {"
+    static_assert(p.ops[3].isField);
+    static_assert(p.ops[3].field.width == 4 && p.ops[3].field.zeroPad);
+    static_assert(p.ops[3].field.type == FormatField::Type::Hex);
+    static_assert(!p.ops[4].isField && p.ops[4].length == 1); // "}"
+
+    static_assert(program(FORMAT_STR("")).count == 0);
+    static_assert(program(FORMAT_STR("{}")).count == 1);
+}
+
+TEST_CASE("Malformed format strings are rejected at compile time")
+{
+    static_assert(program(FORMAT_STR("{")).errorAt == 0);
+    static_assert(program(FORMAT_STR("ab}")).errorAt == 2);
+    static_assert(program(FORMAT_STR("a{:q}")).errorAt == 1);
+    static_assert(program(FORMAT_STR("{:.}")).errorAt == 0);
+    static_assert(program(FORMAT_STR("{:.2x}")).errorAt == 0);
+    static_assert(program(FORMAT_STR("{:99}")).errorAt == 0);
+    static_assert(program(FORMAT_STR("{:08.3d}")).errorAt < 0);
+}
+
+TEST_CASE("Format integers")
+{
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), 0).buffer, "0") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{} {}"), 123, -45).buffer, "123 -45") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), static_cast<int16_t>(-32768)).buffer, "-32768") ==
+          0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), static_cast<uint8_t>(255)).buffer, "255") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), static_cast<int8_t>(-128)).buffer, "-128") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), 4294967295UL).buffer, "4294967295") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), INT32_MIN).buffer, "-2147483648") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}"), true).buffer, "1") == 0);
+}
+
+TEST_CASE("Format hex, binary and characters")
+{
+    CHECK(strcmp(formatted(FORMAT_STR("0x{:x}"), 0xBEEF).buffer, "0xbeef") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("0x{:04X}"), 0xAB).buffer, "0x00AB") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:x}"), static_cast<int8_t>(-1)).buffer, "ff") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:08b}"), static_cast<uint8_t>(5)).buffer, "00000101") ==
+          0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}{:c}"), 'A', 66).buffer, "AB") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:d}"), 'A').buffer, "65") == 0);
+}
+
+TEST_CASE("Format width and padding")
+{
+    CHECK(strcmp(formatted(FORMAT_STR("[{:5}]"), 42).buffer, "[   42]") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:05}]"), -42).buffer, "[-0042]") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:5}]"), -42).buffer, "[  -42]") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:2}]"), 12345).buffer, "[12345]") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:4}]"), "ab").buffer, "[  ab]") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:3c}]"), 'x').buffer, "[  x]") == 0);
+}
+
+TEST_CASE("Format fixed point")
+{
+    CHECK(strcmp(formatted(FORMAT_STR("{:.2}"), 2345).buffer, "23.45") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:.2}"), 5).buffer, "0.05") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:.2}"), -5).buffer, "-0.05") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:.2}"), 0).buffer, "0.00") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:.1}"), -123).buffer, "-12.3") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{:.3}"), 1000L).buffer, "1.000") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:7.2}]"), -2345).buffer, "[ -23.45]") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("[{:07.2}]"), 5).buffer, "[0000.05]") == 0);
+}
+
+TEST_CASE("Format strings and escaped braces")
+{
+    char name[] = "node";
+
+    CHECK(strcmp(formatted(FORMAT_STR("{} {}"), "hello", name).buffer, "hello node") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{}!"), FLASH_STR("flash")).buffer, "flash!") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{{}}")).buffer, "{}") == 0);
+    CHECK(strcmp(formatted(FORMAT_STR("{{{}}}"), 7).buffer, "{7}") == 0);
+}
+
+TEST_CASE("FormatBuffer truncates and stays terminated")
+{
+    char buffer[6];
+
+    CHECK(formatTo(buffer, sizeof(buffer), FORMAT_STR("{}-{}"), 1234, 5678) == 5);
+    CHECK(strcmp(buffer, "1234-") == 0);
+
+    FormatBuffer sink(buffer, sizeof(buffer));
+    format(sink, FORMAT_STR("ab"));
+    CHECK(sink.isTruncated() == false);
+    format(sink, FORMAT_STR("cdef"));
+    CHECK(sink.isTruncated() == true);
+    CHECK(strcmp(sink.str(), "abcde") == 0);
+
+    sink.clear();
+    CHECK(sink.getLength() == 0);
+    CHECK(strcmp(sink.str(), "") == 0);
+}
+
+TEST_CASE("UartSink writes to the TX path")
+{
+    struct FakeUart {
+        char sent[16] {};
+        int  count = 0;
+
+        auto tx(uint8_t byte) -> void { sent[count++] = static_cast<char>(byte); }
+    } uart;
+
+    UartSink out(uart);
+    format(out, FORMAT_STR("T={:.1}"), 215);
+
+    CHECK(uart.count == 6);
+    CHECK(strcmp(uart.sent, "T=21.5") == 0);
+}
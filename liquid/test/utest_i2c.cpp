@@ -1,28 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "mockAvr.h"
+#include <avr/Aht20.h>
 #include <avr/AvrI2c.h>
 
 using namespace liquid;
 
 static constexpr auto testCpuFreq = 16'000'000;
 
-struct TwiRegs {
-    static constexpr auto TWBR = 0xB8;
-    static constexpr auto TWSR = 0xB9;
-    static constexpr auto TWAR = 0xBA;
-    static constexpr auto TWDR = 0xBB;
-    static constexpr auto TWCR = 0xBC;
-    static constexpr auto TWAMR = 0xBD;
-};
-
-// Writing 1 to TWINT bit causes the hardware to clear this bit.
-// This funciton simulates the hardware clearing TWINT bit.
-auto hardwareClearsTwint() -> void
-{
-    writeMemAt(TwiRegs::TWCR) &= ~(1 << 7);
-}
-
 TEST_CASE("Avr I2C - Controller mode")
 {
     mockMemReset();
@@ -88,12 +73,7 @@ TEST_CASE("Avr I2C - Controller mode")
         writeMemAt(TwiRegs::TWSR) = 0x28;
         dev.isr();
 
-        // Send Stop bit
-        CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
-        CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 6) | (1 << 4) | (1 << 2) | (1 << 0)));
-        dev.isr();
-
-        // Stop condition
+        // Send Stop bit. No interrupt follows it, the transaction is done.
         CHECK(dev.getStatus() == AvrI2c::Status::Ok);
         CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 6) | (1 << 4) | (1 << 2) | (1 << 0)));
 
@@ -145,16 +125,459 @@ TEST_CASE("Avr I2C - Controller mode")
         writeMemAt(TwiRegs::TWDR) = 0xCD;
         dev.isr();
 
-        // Send Stop bit
-        CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
-        CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 4) | (1 << 2) | (1 << 0)));
-        dev.isr();
-
-        // Retrieve the data
+        // Retrieve the data and send Stop bit, the transaction is done
         CHECK(dev.getStatus() == AvrI2c::Status::Ok);
         CHECK((int)data[1] == 0xCD);
 
         CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 4) | (1 << 2) | (1 << 0)));
         hardwareClearsTwint();
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Avr I2C - Transaction queue")
+{
+    mockMemReset();
+    AvrI2cController dev;
+
+    struct Completed {
+        int            count;
+        AvrI2c::Status statuses[4];
+    } completed {0, {}};
+
+    const auto onComplete = [](void *c, AvrI2c::Status status) {
+        auto *completed_ = static_cast<Completed *>(c);
+        completed_->statuses[completed_->count++] = status;
+    };
+
+    using Transaction = AvrI2c::Transaction;
+
+    uint8_t tx[] = {0x12};
+    uint8_t rx[] = {0x00};
+
+    dev.submit(Transaction::write(0x10, tx, sizeof(tx), onComplete, &completed));
+    dev.submit(Transaction::read(0x20, rx, sizeof(rx), onComplete, &completed));
+    dev.submit(Transaction::probe(0x30, onComplete, &completed));
+
+    // The first one starts right away, the others wait
+    CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 6) | (1 << 5) | (1 << 2) | (1 << 0)));
+    CHECK(dev.getQueuedCount() == 2);
+    CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
+
+    twiEvent(dev, 0x08);
+    CHECK(memAt(TwiRegs::TWDR) == 0x20);
+    twiEvent(dev, 0x18);
+    CHECK(memAt(TwiRegs::TWDR) == 0x12);
+    twiEvent(dev, 0x28);
+
+    SECTION("the next transaction starts from the interrupt")
+    {
+        // STOP, then START for the next one, from the same interrupt
+        CHECK((memAt(TwiRegs::TWCR) & ((1 << 5) | (1 << 4))) == ((1 << 5) | (1 << 4)));
+        CHECK(completed.count == 1);
+        CHECK(completed.statuses[0] == AvrI2c::Status::Ok);
+        CHECK(dev.getQueuedCount() == 1);
+        CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
+
+        twiEvent(dev, 0x08);
+        CHECK(memAt(TwiRegs::TWDR) == 0x41);
+        twiEvent(dev, 0x40);
+        writeMemAt(TwiRegs::TWDR) = 0x5A;
+        twiEvent(dev, 0x58);
+
+        CHECK(completed.count == 2);
+        CHECK(rx[0] == 0x5A);
+
+        // The probe gets no acknowledge, the queue drains
+        twiEvent(dev, 0x08);
+        CHECK(memAt(TwiRegs::TWDR) == 0x60);
+        twiEvent(dev, 0x20);
+        CHECK((memAt(TwiRegs::TWCR) & ((1 << 5) | (1 << 4))) == (1 << 4));
+
+        CHECK(completed.count == 3);
+        CHECK(completed.statuses[2] == AvrI2c::Status::Nack);
+        CHECK(dev.getStatus() == AvrI2c::Status::Nack);
+        CHECK(dev.getQueuedCount() == 0);
+    }
+
+    SECTION("full queue")
+    {
+        for (int i = 0; i < 3; ++i)
+            CHECK(dev.trySubmit(Transaction::probe(0x40)));
+        CHECK(dev.getQueuedCount() == 4);
+        CHECK(dev.trySubmit(Transaction::probe(0x40)) == false);
+    }
+}
+
+TEST_CASE("Avr I2C - Write then read with repeated START")
+{
+    mockMemReset();
+    AvrI2cController dev;
+
+    uint8_t reg[] = {0x71};
+    uint8_t data[] = {0x00, 0x00};
+
+    dev.writeRead(0x38, reg, sizeof(reg), data, sizeof(data));
+
+    twiEvent(dev, 0x08);
+    CHECK(memAt(TwiRegs::TWDR) == 0x70);
+    twiEvent(dev, 0x18);
+    CHECK(memAt(TwiRegs::TWDR) == 0x71);
+
+    // Register address sent, repeated START instead of STOP
+    twiEvent(dev, 0x28);
+    CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 6) | (1 << 5) | (1 << 2) | (1 << 0)));
+
+    twiEvent(dev, 0x10);
+    CHECK(memAt(TwiRegs::TWDR) == 0x71);
+    CHECK((memAt(TwiRegs::TWCR) & (1 << 5)) == 0);
+
+    twiEvent(dev, 0x40);
+    writeMemAt(TwiRegs::TWDR) = 0x1C;
+    twiEvent(dev, 0x50);
+    CHECK(data[0] == 0x1C);
+    CHECK((memAt(TwiRegs::TWCR) & (1 << 6)) == 0);
+
+    writeMemAt(TwiRegs::TWDR) = 0x80;
+    twiEvent(dev, 0x58);
+    CHECK(memAt(TwiRegs::TWCR) & (1 << 4));
+    CHECK(dev.getStatus() == AvrI2c::Status::Ok);
+    CHECK(data[1] == 0x80);
+}
+
+TEST_CASE("Avr I2C - Scatter-gather write")
+{
+    mockMemReset();
+    AvrI2cController dev;
+
+    static const uint8_t command[] = {0x40};
+    static const uint8_t row[] = {0xA1, 0xA2};
+
+    const AvrI2c::Segment segments[] = {
+        {command, sizeof(command)},
+        {nullptr, 0},
+        {row, sizeof(row)},
+    };
+    dev.write(0x3C, segments, 3);
+
+    twiEvent(dev, 0x08);
+    CHECK(memAt(TwiRegs::TWDR) == 0x78);
+    twiEvent(dev, 0x18);
+    CHECK(memAt(TwiRegs::TWDR) == 0x40);
+    twiEvent(dev, 0x28);
+    CHECK(memAt(TwiRegs::TWDR) == 0xA1);
+    twiEvent(dev, 0x28);
+    CHECK(memAt(TwiRegs::TWDR) == 0xA2);
+
+    // Last segment done
+    twiEvent(dev, 0x28);
+    CHECK(memAt(TwiRegs::TWCR) & (1 << 4));
+    CHECK(dev.getStatus() == AvrI2c::Status::Ok);
+}
+
+TEST_CASE("Avr I2C - Timeout and bus recovery")
+{
+    constexpr uint16_t PINC = 0x26;
+    constexpr uint16_t DDRC = 0x27;
+    constexpr uint16_t PORTC = 0x28;
+    constexpr uint8_t  sdaBit = 1 << 4;
+    constexpr uint8_t  sclBit = 1 << 5;
+
+    // 5 us half periods at 20 MHz, under 0.2 ms in all at 16 MHz
+    static_assert(AvrI2cController::recoveryDelayCycles >= 100);
+    static_assert(AvrI2cController::recoveryHalfPeriods * AvrI2cController::recoveryDelayCycles
+                  < 3200);
+
+    mockMemReset();
+    AvrI2cController dev;
+    SysTimer         clock;
+
+    AvrGpioRegs regs {sfr8(PINC), sfr8(DDRC), sfr8(PORTC), sfr8(0)};
+    GpioSpec    sdaSpec {regs, 4};
+    GpioSpec    sclSpec {regs, 5};
+    Gpio        sda(sdaSpec, sdaSpec.pin);
+    Gpio        scl(sclSpec, sclSpec.pin);
+
+    dev.setTimeout(clock, 10);
+    dev.setRecoveryPins(scl, sda);
+
+    AvrI2c::Status result {AvrI2c::Status::InProgress};
+    const auto     onComplete = [](void *r, AvrI2c::Status status) {
+        *static_cast<AvrI2c::Status *>(r) = status;
+    };
+    const auto tick = [&](int n) {
+        for (int i = 0; i < n; ++i)
+            clock.isr();
+        dev.poll();
+    };
+
+    static const uint8_t data[] = {0x01, 0x02};
+
+    SECTION("Stuck transaction is aborted and the queue goes on")
+    {
+        dev.submit(AvrI2c::Transaction::write(0x20, data, 2, onComplete, &result));
+        dev.write(0x21, data, 1);
+        twiEvent(dev, 0x08);
+        twiEvent(dev, 0x18);
+
+        // No more interrupts, the target holds SDA low until clocked
+        writeMemAt(PINC) = 0;
+        tick(0);
+        tick(9);
+        CHECK(result == AvrI2c::Status::InProgress);
+
+        writeMemAt(PINC) = sdaBit;
+        tick(1);
+        CHECK(result == AvrI2c::Status::Timeout);
+
+        // Both lines released, with the pull-ups
+        CHECK((memAt(DDRC) & (sdaBit | sclBit)) == 0);
+        CHECK((memAt(PORTC) & (sdaBit | sclBit)) == (sdaBit | sclBit));
+
+        // The next transaction was started
+        CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
+        CHECK(dev.getQueuedCount() == 0);
+        CHECK(memAt(TwiRegs::TWCR) == ((1 << 7) | (1 << 6) | (1 << 5) | (1 << 2) | (1 << 0)));
+    }
+
+    SECTION("Each transaction gets its own deadline")
+    {
+        dev.submit(AvrI2c::Transaction::write(0x20, data, 1, onComplete, &result));
+        twiEvent(dev, 0x08);
+        tick(0);
+        tick(8);
+        twiEvent(dev, 0x18);
+        twiEvent(dev, 0x28);
+        CHECK(result == AvrI2c::Status::Ok);
+
+        dev.write(0x21, data, 1);
+        tick(0);
+        tick(8);
+        CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
+        tick(2);
+        CHECK(dev.getStatus() == AvrI2c::Status::Timeout);
+    }
+}
+
+static auto twiEvent(AvrI2cTarget &dev, uint8_t twsr, uint8_t twdr) -> void
+{
+    hardwareClearsTwint();
+    writeMemAt(TwiRegs::TWSR) = twsr;
+    writeMemAt(TwiRegs::TWDR) = twdr;
+    dev.isr();
+}
+
+TEST_CASE("Avr I2C - Target register map")
+{
+    mockMemReset();
+    AvrI2cTarget dev;
+
+    struct Commit {
+        uint8_t first;
+        uint8_t count;
+        int     calls;
+    } commit {0, 0, 0};
+
+    volatile uint8_t regs[4] = {0x11, 0x22, 0x33, 0x44};
+    dev.setRegisters(regs, sizeof(regs), 1);
+    dev.onCommit(
+        [](void *data, uint8_t first, uint8_t count) {
+            auto c = static_cast<Commit *>(data);
+            c->first = first;
+            c->count = count;
+            ++c->calls;
+        },
+        &commit);
+
+    const uint8_t listen = (1 << 7) | (1 << 6) | (1 << 2) | (1 << 0);
+
+    dev.setup(0x42, 0x01);
+    CHECK(memAt(TwiRegs::TWAR) == 0x84);
+    CHECK(memAt(TwiRegs::TWAMR) == 0x02);
+    CHECK(memAt(TwiRegs::TWCR) == listen);
+
+    SECTION("Write with auto-increment")
+    {
+        twiEvent(dev, 0x60, 0x86);
+        CHECK(dev.getAddressed() == 0x43);
+        CHECK(memAt(TwiRegs::TWCR) == listen);
+
+        twiEvent(dev, 0x80, 2); // Register number
+        twiEvent(dev, 0x80, 0xA2);
+        CHECK(regs[2] == 0xA2);
+        CHECK(memAt(TwiRegs::TWCR) == listen);
+
+        // The last register, NACK whatever comes next
+        twiEvent(dev, 0x80, 0xA3);
+        CHECK(regs[3] == 0xA3);
+        CHECK(memAt(TwiRegs::TWCR) == (listen & ~(1 << 6)));
+        CHECK(commit.calls == 0);
+
+        twiEvent(dev, 0xA0, 0);
+        CHECK(memAt(TwiRegs::TWCR) == listen);
+        CHECK(commit.calls == 1);
+        CHECK(commit.first == 2);
+        CHECK(commit.count == 2);
+    }
+
+    SECTION("Read-only registers are not written")
+    {
+        twiEvent(dev, 0x60, 0x84);
+        twiEvent(dev, 0x80, 0);
+        CHECK(memAt(TwiRegs::TWCR) == (listen & ~(1 << 6)));
+
+        twiEvent(dev, 0x88, 0x55);
+        CHECK(regs[0] == 0x11);
+        CHECK(memAt(TwiRegs::TWCR) == listen);
+        CHECK(commit.calls == 0);
+    }
+
+    SECTION("Register number, repeated START, then read")
+    {
+        twiEvent(dev, 0x60, 0x84);
+        twiEvent(dev, 0x80, 1);
+        twiEvent(dev, 0xA0, 0);
+        CHECK(commit.calls == 0);
+
+        twiEvent(dev, 0xA8, 0x85);
+        CHECK(memAt(TwiRegs::TWDR) == 0x22);
+        CHECK(memAt(TwiRegs::TWCR) == listen);
+        twiEvent(dev, 0xB8, 0);
+        CHECK(memAt(TwiRegs::TWDR) == 0x33);
+        twiEvent(dev, 0xB8, 0);
+        CHECK(memAt(TwiRegs::TWDR) == 0x44);
+        twiEvent(dev, 0xB8, 0);
+        CHECK(memAt(TwiRegs::TWDR) == 0xFF); // Past the end
+
+        twiEvent(dev, 0xC0, 0);
+        CHECK(memAt(TwiRegs::TWCR) == listen);
+    }
+
+    SECTION("Bus error releases the lines")
+    {
+        twiEvent(dev, 0x00, 0);
+        CHECK(memAt(TwiRegs::TWCR) == (listen | (1 << 4)));
+    }
+}
+
+TEST_CASE("AHT20 - Fixed-point conversion")
+{
+    // Status, humidity 0xC0000 (75 %), temperature 0x5999A (20 C)
+    const uint8_t data[] = {0x1C, 0xC0, 0x00, 0x05, 0x99, 0x9A};
+
+    const auto m = Aht20::convert(data);
+    CHECK(m.humidity == 7500);
+    CHECK(m.temperature == 2000);
+}
+
+TEST_CASE("AHT20 - Periodic measurement without blocking")
+{
+    mockMemReset();
+    AvrI2cController dev;
+    SysTimer         clock;
+    Aht20            sensor {dev, clock};
+
+    struct Reported {
+        int                      count = 0;
+        Aht20::MeasurementResult last = Aht20::MeasurementResult::err(AvrI2c::Status::Unknown);
+    } reported;
+
+    sensor.onMeasurement(
+        [](void *r, const Aht20::MeasurementResult &result) {
+            auto reported_ = static_cast<Reported *>(r);
+            ++reported_->count;
+            reported_->last = result;
+        },
+        &reported);
+
+    const auto tick = [&](int n) {
+        for (int i = 0; i < n; ++i)
+            clock.isr();
+        sensor.poll();
+    };
+
+    // Command bytes, done with the STOP
+    const auto completeWrite = [&](const uint8_t (&command)[3]) {
+        twiEvent(dev, 0x08);
+        CHECK(memAt(TwiRegs::TWDR) == 0x70);
+        twiEvent(dev, 0x18);
+        for (const auto byte : command) {
+            CHECK(memAt(TwiRegs::TWDR) == byte);
+            twiEvent(dev, 0x28);
+        }
+    };
+
+    const auto completeRead = [&](const uint8_t (&data)[6]) {
+        twiEvent(dev, 0x08);
+        CHECK(memAt(TwiRegs::TWDR) == 0x71);
+        twiEvent(dev, 0x40);
+        for (int i = 0; i < 6; ++i) {
+            writeMemAt(TwiRegs::TWDR) = data[i];
+            twiEvent(dev, i < 5 ? 0x50 : 0x58);
+        }
+    };
+
+    static const uint8_t initialize[] = {0xBE, 0x08, 0x00};
+    static const uint8_t measure[] = {0xAC, 0x33, 0x00};
+    static const uint8_t sample[] = {0x1C, 0x80, 0x00, 0x04, 0x00, 0x00};
+
+    sensor.start(1000);
+    tick(0);
+    completeWrite(initialize);
+
+    // Calibration loads, then the first conversion is triggered
+    tick(9);
+    CHECK(dev.getStatus() == AvrI2c::Status::Ok);
+    tick(1);
+    completeWrite(measure);
+
+    tick(79);
+    CHECK(dev.getStatus() == AvrI2c::Status::Ok);
+    tick(1);
+    CHECK(dev.getStatus() == AvrI2c::Status::InProgress);
+
+    SECTION("Measurement is reported from poll()")
+    {
+        completeRead(sample);
+        CHECK(reported.count == 0);
+
+        tick(0);
+        CHECK(reported.count == 1);
+        REQUIRE(reported.last.isSuccess());
+        CHECK(reported.last.getValue().humidity == 5000);
+        CHECK(reported.last.getValue().temperature == 0);
+
+        // Next sample a period after the previous one started
+        tick(909);
+        CHECK(dev.getStatus() == AvrI2c::Status::Ok);
+        tick(1);
+        completeWrite(measure);
+    }
+
+    SECTION("Still busy, the status is read again")
+    {
+        static const uint8_t busy[] = {0x9C, 0, 0, 0, 0, 0};
+        completeRead(busy);
+
+        tick(9);
+        CHECK(dev.getStatus() == AvrI2c::Status::Ok);
+        tick(1);
+        completeRead(sample);
+        tick(0);
+        CHECK(reported.count == 1);
+        CHECK(reported.last.isSuccess());
+    }
+
+    SECTION("Bus errors are reported and the sensor initialized again")
+    {
+        twiEvent(dev, 0x08);
+        twiEvent(dev, 0x48); // SLA+R not acknowledged
+
+        tick(0);
+        CHECK(reported.count == 1);
+        REQUIRE(reported.last.isError());
+        CHECK(reported.last.getError() == AvrI2c::Status::Nack);
+
+        tick(910);
+        completeWrite(initialize);
+    }
+}
@@ -0,0 +1,337 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "mockAvr.h"
+#include <BinaryLog.h>
+#include <PacketLink.h>
+#include <avr/UartImpl.h>
+
+#include <string.h>
+#include <vector>
+
+using namespace liquid;
+
+using Bytes = std::vector<uint8_t>;
+
+static auto cobsEncode(const Bytes &data) -> Bytes
+{
+    Bytes encoded(static_cast<size_t>(Cobs::maxEncodedSize(static_cast<int>(data.size()))));
+    const auto length = Cobs::encode(data.data(), static_cast<int>(data.size()), encoded.data());
+    encoded.resize(static_cast<size_t>(length));
+    return encoded;
+}
+
+static auto cobsDecode(const Bytes &encoded) -> Bytes
+{
+    uint8_t     buf[600];
+    CobsDecoder decoder(buf, sizeof(buf));
+    for (auto b : encoded)
+        REQUIRE(decoder.feed(b) == CobsDecoder::Status::Busy);
+    REQUIRE(decoder.feed(0) == CobsDecoder::Status::Frame);
+    return Bytes(buf, buf + decoder.getLength());
+}
+
+// Let the UDRE interrupt run until the TX queue is empty, collecting the output.
+// The interrupt disables itself without writing UDR once there is nothing to send.
+static auto drain(Usart::Impl &dev) -> Bytes
+{
+    Bytes out;
+    while (true) {
+        dev.isr();
+        if ((memAt(0xC1) & (1 << 5)) == 0) break;
+        out.push_back(static_cast<uint8_t>(memAt(0xC6)));
+    }
+    return out;
+}
+
+TEST_CASE("CRC-16/CCITT-FALSE")
+{
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    CHECK(Crc16::compute(check, sizeof(check)) == 0x29B1);
+    CHECK(Crc16::compute(check, 0) == 0xFFFF);
+
+    const uint8_t withCrc[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9', 0x29, 0xB1};
+    CHECK(Crc16::compute(withCrc, sizeof(withCrc)) == 0);
+}
+
+TEST_CASE("COBS encoding")
+{
+    CHECK(cobsEncode({}) == Bytes {0x01});
+    CHECK(cobsEncode({0x00}) == Bytes {0x01, 0x01});
+    CHECK(cobsEncode({0x00, 0x00}) == Bytes {0x01, 0x01, 0x01});
+    CHECK(cobsEncode({0x11, 0x22, 0x00, 0x33}) == Bytes {0x03, 0x11, 0x22, 0x02, 0x33});
+    CHECK(cobsEncode({0x11, 0x00, 0x00, 0x00}) == Bytes {0x02, 0x11, 0x01, 0x01, 0x01});
+
+    Bytes run254;
+    for (int i = 1; i <= 254; ++i)
+        run254.push_back(static_cast<uint8_t>(i));
+    auto encoded = cobsEncode(run254);
+    CHECK(encoded.size() == 255);
+    CHECK(encoded[0] == 0xFF);
+
+    run254.push_back(0);
+    encoded = cobsEncode(run254);
+    CHECK(encoded.size() == 257);
+    CHECK(encoded[255] == 0x01);
+    CHECK(encoded[256] == 0x01);
+
+    SECTION("segments")
+    {
+        const uint8_t a[] = {1, 2, 0};
+        const uint8_t b[] = {3, 4};
+
+        const Cobs::Segment segments[] = {{a, sizeof(a)}, {nullptr, 0}, {b, sizeof(b)}};
+
+        struct Out {
+            Bytes            bytes;
+            std::vector<int> runSegments;
+
+            auto code(uint8_t c) -> void { bytes.push_back(c); }
+            auto data(int segment, const uint8_t *run, int length) -> void
+            {
+                bytes.insert(bytes.end(), run, run + length);
+                runSegments.push_back(segment);
+            }
+        } out;
+
+        Cobs::encode(segments, 3, out);
+        CHECK(out.bytes == Bytes {0x03, 1, 2, 0x03, 3, 4});
+        CHECK(out.runSegments == std::vector<int> {0, 2});
+    }
+}
+
+TEST_CASE("COBS decoding")
+{
+    for (const auto &data : {Bytes {}, Bytes {0}, Bytes {1, 0, 2, 0, 0}, Bytes(300, 0x55)}) {
+        CHECK(cobsDecode(cobsEncode(data)) == data);
+    }
+
+    Bytes mixed;
+    for (int i = 0; i < 600; ++i)
+        mixed.push_back(static_cast<uint8_t>(i % 255 == 0 ? 0 : i));
+    mixed.resize(599);
+    CHECK(cobsDecode(cobsEncode(mixed)) == mixed);
+
+    uint8_t     buf[4];
+    CobsDecoder decoder(buf, sizeof(buf));
+    CHECK(decoder.feed(0) == CobsDecoder::Status::Empty);
+
+    for (auto b : {0x06, 1, 2, 3, 4, 5})
+        decoder.feed(static_cast<uint8_t>(b));
+    CHECK(decoder.feed(0) == CobsDecoder::Status::Overrun);
+
+    for (auto b : {0x04, 1})
+        decoder.feed(static_cast<uint8_t>(b));
+    CHECK(decoder.feed(0) == CobsDecoder::Status::Malformed);
+
+    for (auto b : {0x02, 7})
+        decoder.feed(static_cast<uint8_t>(b));
+    CHECK(decoder.feed(0) == CobsDecoder::Status::Frame);
+    CHECK(decoder.getLength() == 1);
+    CHECK(buf[0] == 7);
+}
+
+TEST_CASE("Packet link")
+{
+    mockMemReset();
+    Usart::Impl dev(0xC0);
+    dev.setupUart(F_CPU, 115200);
+
+    uint8_t                 rxBuf[32];
+    PacketLink<Usart::Impl> link(dev, rxBuf, sizeof(rxBuf));
+
+    const uint8_t payload[] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x00, 0x01, 0x02};
+
+    SECTION("send")
+    {
+        int  completed = 0;
+        auto onComplete = IrqHandler {[](void *n) { ++*static_cast<int *>(n); }, &completed};
+        link.send(payload, sizeof(payload), onComplete);
+        CHECK(completed == 0);
+
+        const auto wire = drain(dev);
+        CHECK(completed == 1);
+        REQUIRE(!wire.empty());
+        CHECK(wire.back() == 0);
+
+        const Bytes frame(wire.begin(), wire.end() - 1);
+        const auto  decoded = cobsDecode(frame);
+        REQUIRE(decoded.size() == sizeof(payload) + 2);
+        CHECK(Bytes(decoded.begin(), decoded.begin() + sizeof(payload)) ==
+              Bytes(payload, payload + sizeof(payload)));
+        CHECK(Crc16::compute(decoded.data(), static_cast<int>(decoded.size())) == 0);
+
+        SECTION("loopback")
+        {
+            for (auto b : wire)
+                link.receive(b);
+            REQUIRE(link.isFrameReady());
+            CHECK(link.getLength() == sizeof(payload));
+            CHECK(Bytes(link.payload(), link.payload() + link.getLength()) ==
+                  Bytes(payload, payload + sizeof(payload)));
+
+            // Held frame, the next one is lost
+            for (auto b : wire)
+                link.receive(b);
+            CHECK(link.getLostFrames() == 1);
+            link.release();
+            CHECK(!link.isFrameReady());
+        }
+
+        SECTION("corrupted")
+        {
+            auto bad = wire;
+            bad[2] ^= 0x01;
+            for (auto b : bad)
+                link.receive(b);
+            CHECK(!link.isFrameReady());
+            CHECK(link.getBadFrames() == 1);
+        }
+    }
+
+    SECTION("receive in the RX interrupt")
+    {
+        link.send(payload, sizeof(payload), {nullptr, nullptr});
+        const auto wire = drain(dev);
+
+        struct Received {
+            int   count;
+            Bytes data;
+        } received {0, {}};
+
+        link.setFrameHandler(
+            [](void *r, const uint8_t *data, int length) {
+                auto *received_ = static_cast<Received *>(r);
+                ++received_->count;
+                received_->data.assign(data, data + length);
+            },
+            &received);
+        link.attach();
+
+        for (int i = 0; i < 2; ++i) {
+            for (auto b : wire) {
+                writeMemAt(0xC6) = b;
+                dev.rxIsr();
+            }
+        }
+        CHECK(received.count == 2);
+        CHECK(received.data == Bytes(payload, payload + sizeof(payload)));
+        CHECK(!link.isFrameReady());
+        CHECK(dev.available() == 0);
+    }
+
+    SECTION("framing bytes ignore the Drop policy")
+    {
+        struct Wire {
+            Usart::Impl *dev;
+            Bytes        out;
+        } wire {&dev, {}};
+
+        // Each sleep waiting for room ends with a UDRE interrupt
+        mockSleep.wakeHandler = {[](void *w) {
+                                     auto *wire_ = static_cast<Wire *>(w);
+                                     wire_->dev->isr();
+                                     wire_->out.push_back(static_cast<uint8_t>(memAt(0xC6)));
+                                 },
+                                 &wire};
+
+        dev.setOverflowPolicy(Usart::OverflowPolicy::Drop);
+        constexpr int filler = Usart::Impl::txBufferSize - 4;
+        for (int i = 0; i < filler; ++i)
+            dev.tx('x');
+
+        Sys::enableInterrupts();
+        link.post(payload, sizeof(payload));
+        Sys::disableInterrupts();
+        mockSleep.wakeHandler = {nullptr, nullptr};
+
+        CHECK(dev.getDroppedBytes() == 0);
+        CHECK(mockSleep.count > 0);
+
+        const auto rest = drain(dev);
+        wire.out.insert(wire.out.end(), rest.begin(), rest.end());
+        REQUIRE(wire.out.size() > filler);
+        CHECK(wire.out.back() == 0);
+
+        const Bytes frame(wire.out.begin() + filler, wire.out.end() - 1);
+        const auto  decoded = cobsDecode(frame);
+        REQUIRE(decoded.size() == sizeof(payload) + 2);
+        CHECK(Bytes(decoded.begin(), decoded.begin() + sizeof(payload)) ==
+              Bytes(payload, payload + sizeof(payload)));
+    }
+}
+
+TEST_CASE("Binary log")
+{
+    mockMemReset();
+    Usart::Impl dev(0xC0);
+    dev.setupUart(F_CPU, 115200);
+
+    uint8_t                 rxBuf[32];
+    PacketLink<Usart::Impl> link(dev, rxBuf, sizeof(rxBuf));
+    BinaryLog<Usart::Impl>  log(link);
+
+    const auto fmt = FORMAT_STR("T={:.2} C n={} {}");
+    using Site = LogSite<decltype(fmt), int16_t, uint32_t, const char *>;
+
+    SECTION("site record")
+    {
+        static_assert(Site::types[0] == 'h' && Site::types[1] == 'I' && Site::types[2] == 's');
+        static_assert(LogSite<decltype(fmt), int8_t, uint16_t, char, FlashStr>::id != Site::id);
+
+        const Bytes expected = {0xA5,
+                                'L',
+                                'o',
+                                'G',
+                                static_cast<uint8_t>(Site::id),
+                                static_cast<uint8_t>(Site::id >> 8),
+                                'h',
+                                'I',
+                                's',
+                                0};
+        const Bytes record(Site::record.bytes, Site::record.bytes + sizeof(Site::record.bytes));
+        CHECK(Bytes(record.begin(), record.begin() + 10) == expected);
+        CHECK(strcmp(reinterpret_cast<const char *>(record.data() + 10), "T={:.2} C n={} {}") == 0);
+        CHECK(record.back() == 0);
+    }
+
+    SECTION("frame is the ID and the raw arguments")
+    {
+        const char *name = "ok";
+        log.write(fmt, static_cast<int16_t>(-2345), static_cast<uint32_t>(0x01020304), name);
+
+        const auto wire = drain(dev);
+        REQUIRE(!wire.empty());
+        CHECK(wire.back() == 0);
+
+        const auto decoded = cobsDecode(Bytes(wire.begin(), wire.end() - 1));
+        CHECK(Crc16::compute(decoded.data(), static_cast<int>(decoded.size())) == 0);
+
+        const Bytes payload(decoded.begin(), decoded.end() - 2);
+        const Bytes expected = {static_cast<uint8_t>(Site::id),
+                                static_cast<uint8_t>(Site::id >> 8),
+                                0xD7,
+                                0xF6,
+                                0x04,
+                                0x03,
+                                0x02,
+                                0x01,
+                                'o',
+                                'k',
+                                0};
+        CHECK(payload == expected);
+    }
+
+    SECTION("strings are cut to fit the frame")
+    {
+        char longName[40];
+        memset(longName, 'x', sizeof(longName) - 1);
+        longName[sizeof(longName) - 1] = 0;
+
+        log.write(FORMAT_STR("{}"), longName);
+
+        const auto wire = drain(dev);
+        const auto decoded = cobsDecode(Bytes(wire.begin(), wire.end() - 1));
+        REQUIRE(decoded.size() == BinaryLog<Usart::Impl>::maxPayload + 2);
+        CHECK(decoded[BinaryLog<Usart::Impl>::maxPayload - 1] == 0);
+    }
+}
@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "mockAvr.h"
+#include <avr/AutoBaud.h>
 #include <avr/AvrTimer16.h>
 #include <avr/AvrTimer8.h>
 
@@ -226,3 +227,107 @@ TEST_CASE("AvrTimer16-FastPWM")
         CHECK(memAt(Timer16Regs::TIMSK1) == 0x00);
     }
 }
+
+TEST_CASE("Auto baud estimate")
+{
+    // 9600 baud at 16 MHz, 1666.7 ticks per bit
+    const uint16_t edges9600[] = {100, 3433, 6767, 10100, 13433};
+    CHECK(AutoBaud::estimate(F_CPU, edges9600) == 9600);
+
+    // 115200 baud, timestamps wrapping around
+    const uint16_t edges115200[] = {65500, 242, 520, 798, 1075};
+    const auto     baud = AutoBaud::estimate(F_CPU, edges115200);
+    CHECK(baud > 115200 - 1000);
+    CHECK(baud < 115200 + 1000);
+    CHECK(AutoBaud::snap(baud) == 115200);
+
+    // Not 0x55, the falling edges are not evenly spaced
+    const uint16_t uneven[] = {0, 100, 3000, 3100, 6000};
+    CHECK(AutoBaud::estimate(F_CPU, uneven) == 0);
+}
+
+TEST_CASE("Auto baud detect")
+{
+    mockMemReset();
+    AutoBaud autoBaud {AvrTimer16(t1cfg), F_CPU};
+
+    constexpr uint16_t TIFR1 = 0x36;
+    constexpr uint16_t ICR1 = 0x86;
+    constexpr uint8_t  ICF = 1 << 5;
+    constexpr uint8_t  TOV = 1 << 0;
+
+    // The flags in the mock read back as written, each step sets the one pending
+    const auto capture = [&](uint16_t timestamp) {
+        sfr16(ICR1) = timestamp;
+        writeMemAt(TIFR1) = ICF;
+        return autoBaud.poll();
+    };
+    const auto overflow = [&]() {
+        writeMemAt(TIFR1) = TOV;
+        return autoBaud.poll();
+    };
+
+    autoBaud.start(3);
+    CHECK(memAt(Timer16Regs::TCCR1B) == ((1 << 7) | 1)); // ICNC, no prescaler
+
+    SECTION("Sync character")
+    {
+        writeMemAt(TIFR1) = 0;
+        CHECK(!autoBaud.poll());
+
+        const uint16_t edges[] = {65500, 242, 520, 798, 1075};
+        CHECK(!capture(edges[0]));
+        CHECK(!overflow()); // A single wrap within the character is fine
+        for (int i = 1; i < 4; ++i)
+            CHECK(!capture(edges[i]));
+        CHECK(capture(edges[4]));
+
+        REQUIRE(autoBaud.getResult().isSuccess());
+        CHECK(autoBaud.getResult().getValue() == 115200);
+        CHECK((memAt(Timer16Regs::TCCR1B) & 0x07) == 0);
+    }
+
+    SECTION("A character longer than a timer period starts over")
+    {
+        CHECK(!capture(100));
+        CHECK(!capture(3433));
+        CHECK(!overflow());
+        CHECK(!overflow());
+
+        // Restarted, the next five edges are a new character
+        const uint16_t edges[] = {100, 3433, 6767, 10100, 13433};
+        for (int i = 0; i < 4; ++i)
+            CHECK(!capture(edges[i]));
+        CHECK(capture(edges[4]));
+        REQUIRE(autoBaud.getResult().isSuccess());
+        CHECK(autoBaud.getResult().getValue() == 9600);
+    }
+
+    SECTION("Timeout")
+    {
+        CHECK(!capture(100));
+        CHECK(!overflow());
+        CHECK(!overflow());
+        CHECK(overflow());
+        CHECK(autoBaud.getResult().getError() == AutoBaud::Error::Timeout);
+        CHECK((memAt(Timer16Regs::TCCR1B) & 0x07) == 0);
+    }
+
+    SECTION("Above the measurable range")
+    {
+        // 1M baud, 16 ticks per bit
+        for (uint16_t t = 0; t < 4 * 32; t += 32)
+            CHECK(!capture(t));
+        CHECK(capture(128));
+        CHECK(autoBaud.getResult().getError() == AutoBaud::Error::Unsupported);
+    }
+
+    SECTION("detect()")
+    {
+        // With the mock's stuck capture flag, every poll sees an edge at the same time
+        sfr16(ICR1) = 1000;
+        const auto result = autoBaud.detect();
+        CHECK(result.getError() == AutoBaud::Error::InvalidSync);
+        CHECK((memAt(Timer16Regs::TCCR1B) & 0x07) == 0);
+    }
+}
@@ -0,0 +1,793 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "mockAvr.h"
+#include <LineAssembler.h>
+#include <avr/AvrUsartSpi.h>
+#include <avr/UartImpl.h>
+
+#include <string.h>
+
+using namespace liquid;
+
+// Simulate the hardware receiving a byte and raising the RX Complete interrupt
+static auto receive(Usart::Impl &dev, uint8_t data) -> void
+{
+    writeMemAt(Usart0Regs::UDR) = data;
+    dev.rxIsr();
+}
+
+TEST_CASE("Avr Usart - RX buffer")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+
+    SECTION("Setup enables RX interrupt")
+    {
+        dev.setupUart(F_CPU, 19200);
+        CHECK(memAt(Usart0Regs::UBRRL) == 51);
+        CHECK(memAt(Usart0Regs::UCSRB) == ((1 << 7) | (1 << 4) | (1 << 3)));
+    }
+
+    SECTION("Non-blocking reads")
+    {
+        uint8_t buf[8] = {0};
+
+        CHECK(dev.available() == 0);
+        CHECK(dev.peek() == -1);
+        CHECK(dev.read(buf, sizeof(buf)) == 0);
+
+        receive(dev, 'a');
+        receive(dev, 'b');
+        receive(dev, 'c');
+
+        CHECK(dev.available() == 3);
+        CHECK(dev.isRxReady());
+        CHECK(dev.peek() == 'a');
+
+        CHECK(dev.read(buf, 2) == 2);
+        CHECK(buf[0] == 'a');
+        CHECK(buf[1] == 'b');
+        CHECK(dev.available() == 1);
+
+        CHECK(dev.rx() == 'c');
+        CHECK(dev.available() == 0);
+        CHECK(!dev.isRxReady());
+    }
+
+    SECTION("Overflow drops new bytes")
+    {
+        for (int i = 0; i < Usart::Impl::rxBufferSize + 4; ++i) {
+            receive(dev, static_cast<uint8_t>(i));
+        }
+
+        CHECK(dev.available() == Usart::Impl::rxBufferSize);
+        CHECK(dev.rx() == 0);
+        CHECK(dev.peek() == 1);
+    }
+}
+
+// Simulate the hardware raising Data Register Empty interrupt,
+// returns the byte written to UDR.
+static auto transmit(Usart::Impl &dev) -> int
+{
+    writeMemAt(Usart0Regs::UDR) = 0;
+    dev.isr();
+    return memAt(Usart0Regs::UDR);
+}
+
+static auto isUdrieSet() -> bool
+{
+    return (memAt(Usart0Regs::UCSRB) & (1 << 5)) != 0;
+}
+
+TEST_CASE("Avr Usart - TX queue")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+
+    SECTION("Buffered and zero-copy data is sent in order")
+    {
+        static int    completed = 0;
+        const uint8_t data[] = {'x', 'y'};
+        IrqHandler    onComplete = {[](void *) { ++completed; }, nullptr};
+
+        completed = 0;
+        dev.tx('a');
+        CHECK(isUdrieSet());
+        dev.tx(data, sizeof(data), onComplete);
+        dev.tx('b');
+        dev.tx('c');
+
+        CHECK(transmit(dev) == 'a');
+        CHECK(transmit(dev) == 'x');
+        CHECK(completed == 0);
+        CHECK(transmit(dev) == 'y');
+        CHECK(completed == 1);
+        CHECK(transmit(dev) == 'b');
+        CHECK(transmit(dev) == 'c');
+        CHECK(isUdrieSet());
+
+        // Nothing left, the interrupt disables itself
+        dev.isr();
+        CHECK(!isUdrieSet());
+        dev.flush();
+    }
+
+    SECTION("Multiple buffers are chained")
+    {
+        const uint8_t b1[] = {1, 2};
+        const uint8_t b2[] = {3};
+        const uint8_t b3[] = {4, 5};
+
+        dev.tx(b1, sizeof(b1));
+        dev.tx(b2, sizeof(b2));
+        dev.tx(b3, sizeof(b3));
+
+        for (int i = 1; i <= 5; ++i) {
+            CHECK(transmit(dev) == i);
+        }
+        dev.isr();
+        CHECK(!isUdrieSet());
+    }
+}
+
+TEST_CASE("Avr Usart - TX overflow policy")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+
+    constexpr int size = Usart::Impl::txBufferSize;
+    for (int i = 0; i < size; ++i) {
+        dev.tx(static_cast<uint8_t>(i));
+    }
+
+    SECTION("Drop")
+    {
+        dev.setOverflowPolicy(Usart::OverflowPolicy::Drop);
+        dev.tx(0xAA);
+        dev.tx(0xBB);
+        CHECK(dev.getDroppedBytes() == 2);
+
+        for (int i = 0; i < size; ++i) {
+            CHECK(transmit(dev) == i);
+        }
+        dev.isr();
+        CHECK(!isUdrieSet());
+    }
+
+    SECTION("Overwrite oldest")
+    {
+        dev.setOverflowPolicy(Usart::OverflowPolicy::OverwriteOldest);
+        dev.tx(0xAA);
+        dev.tx(0xBB);
+        CHECK(dev.getDroppedBytes() == 2);
+
+        for (int i = 2; i < size; ++i) {
+            CHECK(transmit(dev) == i);
+        }
+        CHECK(transmit(dev) == 0xAA);
+        CHECK(transmit(dev) == 0xBB);
+        dev.isr();
+        CHECK(!isUdrieSet());
+    }
+
+    SECTION("Overwrite oldest skips zero-copy buffers")
+    {
+        static const uint8_t data[] = {0xF0};
+
+        dev.setOverflowPolicy(Usart::OverflowPolicy::OverwriteOldest);
+        dev.tx(data, sizeof(data));
+
+        // Drain all buffered bytes but the last one
+        for (int i = 0; i < size - 1; ++i) {
+            CHECK(transmit(dev) == i);
+        }
+        for (int i = 0; i < size - 1; ++i) {
+            dev.tx(static_cast<uint8_t>(0x80 + i));
+        }
+
+        // Discards the byte queued before the zero-copy buffer, leaving an empty request
+        dev.tx(0xAA);
+        CHECK(dev.getDroppedBytes() == 1);
+
+        CHECK(transmit(dev) == 0xF0);
+        for (int i = 0; i < size - 1; ++i) {
+            CHECK(transmit(dev) == 0x80 + i);
+        }
+        CHECK(transmit(dev) == 0xAA);
+    }
+
+    SECTION("Block with the interrupts disabled")
+    {
+        // Like printing from an interrupt handler: the UDRE interrupt can't make room,
+        // the data register is polled instead
+        REQUIRE(!Sys::areInterruptsEnabled());
+        writeMemAt(Usart0Regs::UCSRA) = 1 << 5;
+
+        dev.tx(0xAA);
+        CHECK(memAt(Usart0Regs::UDR) == 0);
+        CHECK(dev.getDroppedBytes() == 0);
+
+        dev.flush();
+        CHECK(memAt(Usart0Regs::UDR) == 0xAA);
+        CHECK(dev.getStats().bytesSent == size + 1);
+    }
+}
+
+TEST_CASE("Avr Usart - Baud rate")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+
+    using Config = Usart::BaudConfig;
+    using Mode = Config::Mode;
+
+    SECTION("Baud rate calculation")
+    {
+        static_assert(Usart::Impl::getBaudRate(F_CPU, 103, Mode::Normal) ==
+                      16000000.0f / 1664.0f);
+        static_assert(Usart::Impl::getBaudRate(F_CPU, 16, Mode::DoubleSpeed) ==
+                      16000000.0f / 136.0f);
+
+        static_assert(Usart::Impl::configureBaud(F_CPU, 9600) == Config {true, Mode::Normal, 103});
+        static_assert(Usart::Impl::configureBaud(F_CPU, 19200) == Config {true, Mode::Normal, 51});
+        static_assert(Usart::Impl::configureBaud(F_CPU, 115200) ==
+                      Config {true, Mode::DoubleSpeed, 16});
+        static_assert(Usart::Impl::configureBaud(F_CPU, 250000) == Config {true, Mode::Normal, 3});
+        static_assert(Usart::Impl::configureBaud(F_CPU, 500000) == Config {true, Mode::Normal, 1});
+        static_assert(Usart::Impl::configureBaud(F_CPU, 1000000) == Config {true, Mode::Normal, 0});
+        static_assert(Usart::Impl::configureBaud(F_CPU, 2000000) ==
+                      Config {true, Mode::DoubleSpeed, 0});
+
+        // Normal mode alone is 3.5% off at 115200
+        static_assert(!Usart::Impl::configureBaud(F_CPU, Mode::Normal, 115200).isValid);
+        static_assert(Usart::Impl::configureBaud(F_CPU, Mode::Normal, 115200, 0.04f).isValid);
+
+        // Out of range
+        static_assert(!Usart::Impl::configureBaud(F_CPU, 4000000).isValid);
+        static_assert(!Usart::Impl::configureBaud(F_CPU, 150).isValid);
+        static_assert(!Usart::Impl::configureBaud(F_CPU, 0).isValid);
+
+        // Not achievable within tolerance: between 1M and 2M there is nothing
+        static_assert(!Usart::Impl::configureBaud(F_CPU, 1500000).isValid);
+    }
+
+    SECTION("Integer-only solver makes the same choice")
+    {
+        const unsigned long rates[] = {0,      150,    1200,    9600,    19200,   57600,  115200,
+                                       230400, 250000, 1000000, 1500000, 2000000, 4000000};
+        for (const auto baud : rates) {
+            CHECK(Usart::Impl::findBaud(F_CPU, baud) == Usart::Impl::configureBaud(F_CPU, baud));
+            CHECK(Usart::Impl::findBaud(8000000, baud) ==
+                  Usart::Impl::configureBaud(8000000, baud));
+        }
+        static_assert(Usart::Impl::findBaud(F_CPU, 115200) == Config {true, Mode::DoubleSpeed, 16});
+        static_assert(!Usart::Impl::findBaud(F_CPU, Mode::Normal, 115200).isValid);
+    }
+
+    SECTION("Apply")
+    {
+        dev.apply(Usart::Impl::configureBaud<F_CPU, 115200>());
+        CHECK(memAt(Usart0Regs::UCSRA) == (1 << 1));
+        CHECK(memAt(Usart0Regs::UBRRL) == 16);
+        CHECK(memAt(Usart0Regs::UBRRH) == 0);
+
+        CHECK(dev.setBaud(F_CPU, 9600));
+        CHECK(memAt(Usart0Regs::UCSRA) == 0);
+        CHECK(memAt(Usart0Regs::UBRRL) == 103);
+
+        // Invalid rates are reported and leave the settings alone
+        CHECK(!dev.setBaud(F_CPU, 1500000));
+        CHECK(!dev.apply(Usart::Impl::configureBaud(F_CPU, 150)));
+        CHECK(memAt(Usart0Regs::UBRRL) == 103);
+    }
+
+    SECTION("Setup with an invalid rate")
+    {
+        CHECK(!dev.setupUart(F_CPU, 1500000));
+        CHECK(memAt(Usart0Regs::UCSRB) == 0);
+    }
+}
+
+TEST_CASE("Avr Usart - Static register addresses")
+{
+    mockMemReset();
+    UsartT<Usart0Regs::UCSRA> dev;
+
+    dev.setupUart(F_CPU, 115200);
+    CHECK(memAt(Usart0Regs::UCSRA) == (1 << 1));
+    CHECK(memAt(Usart0Regs::UBRRL) == 16);
+    CHECK(memAt(Usart0Regs::UCSRB) == ((1 << 7) | (1 << 4) | (1 << 3)));
+
+    writeMemAt(Usart0Regs::UDR) = 'z';
+    dev.rxIsr();
+    CHECK(dev.rx() == 'z');
+
+    dev.tx('q');
+    dev.isr();
+    CHECK(memAt(Usart0Regs::UDR) == 'q');
+}
+
+TEST_CASE("Avr Usart - Per-instance interrupt dispatch")
+{
+    mockMemReset();
+    Usart::Impl usart0(0xC0);
+    UsartT<0x130> usart3;
+
+    usart0.setupUart(F_CPU, 19200);
+    usart3.setupUart(F_CPU, 19200);
+
+    writeMemAt(0xC6) = 'a';
+    mockIrqHandler(Irq::Usart0Rx)();
+    writeMemAt(0x136) = 'd';
+    mockIrqHandler(Irq::Usart3Rx)();
+
+    CHECK(usart0.available() == 1);
+    CHECK(usart0.rx() == 'a');
+    CHECK(usart3.available() == 1);
+    CHECK(usart3.rx() == 'd');
+
+    usart3.tx('x');
+    mockIrqHandler(Irq::Usart3Udre)();
+    CHECK(memAt(0x136) == 'x');
+    CHECK(memAt(0xC6) == 'a');
+
+    int txComplete = 0;
+    usart3.setTxCompleteHandler({[](void *count) { ++*static_cast<int *>(count); }, &txComplete});
+    CHECK((memAt(0x131) & (1 << 6)) != 0);
+    mockIrqHandler(Irq::Usart3Tx)();
+    CHECK(txComplete == 1);
+}
+
+TEST_CASE("Line assembler")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    char          buf[8];
+    LineAssembler line(buf, sizeof(buf));
+
+    const auto feed = [&](const char *text) {
+        bool complete = false;
+        for (; *text != 0; ++text)
+            complete = line.feed(static_cast<uint8_t>(*text));
+        return complete;
+    };
+
+    SECTION("line endings")
+    {
+        CHECK(!feed("ab"));
+        CHECK(feed("c\r"));
+        CHECK(strcmp(line.line(), "abc") == 0);
+        CHECK(line.getLength() == 3);
+
+        line.release();
+        CHECK(!feed("\n"));
+        CHECK(feed("d\n"));
+        CHECK(strcmp(line.line(), "d") == 0);
+
+        line.release();
+        CHECK(feed("\n"));
+        CHECK(line.getLength() == 0);
+    }
+
+    SECTION("held line drops input")
+    {
+        CHECK(feed("a\r"));
+        CHECK(!feed("bc"));
+        CHECK(strcmp(line.line(), "a") == 0);
+    }
+
+    SECTION("backspace and size limit")
+    {
+        CHECK(feed("abx\bc\x7f\x7f" "0123456789\r"));
+        CHECK(strcmp(line.line(), "a012345") == 0);
+    }
+
+    SECTION("echo")
+    {
+        line.setEcho(dev);
+        feed("ab\b\r");
+
+        const char expected[] = "ab\b \b\r\n";
+        for (size_t i = 0; i < strlen(expected); ++i)
+            CHECK(transmit(dev) == expected[i]);
+        dev.isr();
+        CHECK(!isUdrieSet());
+    }
+
+    SECTION("poll")
+    {
+        receive(dev, 'o');
+        CHECK(line.poll(dev) == nullptr);
+        receive(dev, 'k');
+        receive(dev, '\r');
+        receive(dev, 'n');
+        const char *result = line.poll(dev);
+        REQUIRE(result != nullptr);
+        CHECK(strcmp(result, "ok") == 0);
+        CHECK(dev.available() == 1);
+
+        CHECK(line.poll(dev) == nullptr);
+        CHECK(strcmp(line.line(), "n") == 0);
+    }
+
+    SECTION("fed from the RX interrupt")
+    {
+        struct Result {
+            int  count;
+            char text[8];
+        } result {0, {}};
+
+        line.setLineHandler(
+            [](void *data, const char *text, int) {
+                auto *r = static_cast<Result *>(data);
+                ++r->count;
+                strcpy(r->text, text);
+            },
+            &result);
+        dev.setRxHandler(LineAssembler::rxFunc, &line);
+
+        for (auto ch : {'h', 'i', '\r', '\n', 'x', '\n'})
+            receive(dev, static_cast<uint8_t>(ch));
+
+        CHECK(result.count == 2);
+        CHECK(strcmp(result.text, "x") == 0);
+        CHECK(dev.available() == 0);
+    }
+}
+
+TEST_CASE("Avr Usart - readLine stays within the buffer")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    for (auto ch : {'1', '2', '3', '4', '5', '\n'})
+        receive(dev, static_cast<uint8_t>(ch));
+
+    uint8_t buf[5] = {0xff, 0xff, 0xff, 0xff, 0xff};
+    CHECK(dev.readLine(buf, 4) == 3);
+    CHECK(buf[3] == 0);
+    CHECK(buf[4] == 0xff);
+}
+
+TEST_CASE("Avr Usart - Master SPI mode")
+{
+    mockMemReset();
+    UsartSpiT<Usart0Regs::UCSRA> spi;
+
+    constexpr auto clock = AvrUsartSpi::configureClock<F_CPU, 4000000>();
+    static_assert(clock.ubrr == 1);
+
+    CHECK_FALSE(spi.setup(AvrUsartSpi::configureClock(F_CPU, 1000)));
+    CHECK(memAt(Usart0Regs::UCSRB) == 0);
+
+    CHECK(spi.setup(clock, 3, AvrUsartSpi::BitOrder::LsbFirst));
+    CHECK(memAt(Usart0Regs::UCSRC) == 0xC7);
+    CHECK(memAt(Usart0Regs::UCSRB) == ((1 << 4) | (1 << 3)));
+    CHECK(memAt(Usart0Regs::UBRRL) == 1);
+
+    spi.setMode(0);
+    CHECK(memAt(Usart0Regs::UCSRC) == 0xC0);
+
+    SECTION("interrupt driven transfer")
+    {
+        writeMemAt(Usart0Regs::UCSRA) = 1 << 5; // UDRE
+
+        const uint8_t tx[] = {0x11, 0x22, 0x33};
+        uint8_t       rx[3] = {};
+        int           completed = 0;
+
+        spi.transferAsync(tx, rx, 3, {[](void *n) { ++*static_cast<int *>(n); }, &completed});
+        CHECK(spi.isBusy());
+        CHECK(memAt(Usart0Regs::UCSRB) & (1 << 7));
+        CHECK(memAt(Usart0Regs::UDR) == 0x22);
+
+        writeMemAt(Usart0Regs::UDR) = 0xA1;
+        mockIrqHandler(Irq::Usart0Rx)();
+        CHECK(memAt(Usart0Regs::UDR) == 0x33);
+
+        writeMemAt(Usart0Regs::UDR) = 0xA2;
+        spi.rxIsr();
+        writeMemAt(Usart0Regs::UDR) = 0xA3;
+        spi.rxIsr();
+
+        CHECK(!spi.isBusy());
+        CHECK(completed == 1);
+        CHECK((memAt(Usart0Regs::UCSRB) & (1 << 7)) == 0);
+        CHECK(rx[0] == 0xA1);
+        CHECK(rx[1] == 0xA2);
+        CHECK(rx[2] == 0xA3);
+    }
+}
+
+TEST_CASE("Avr Usart - Multi-processor communication mode")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    constexpr uint8_t MPCM = 1 << 0;
+    constexpr uint8_t RXB8 = 1 << 1;
+    constexpr uint8_t UCSZ2 = 1 << 2;
+
+    const auto receiveFrame = [&](uint8_t data, bool address) {
+        writeMemAt(Usart0Regs::UCSRB) = static_cast<uint8_t>(
+            address ? memAt(Usart0Regs::UCSRB) | RXB8 : memAt(Usart0Regs::UCSRB) & ~RXB8);
+        receive(dev, data);
+    };
+
+    SECTION("node")
+    {
+        dev.enableMultiprocessorMode(0x12, 0x00);
+        CHECK(memAt(Usart0Regs::UCSRA) & MPCM);
+        CHECK(memAt(Usart0Regs::UCSRB) & UCSZ2);
+        CHECK((memAt(Usart0Regs::UCSRC) & 0x06) == 0x06);
+        CHECK(!dev.isAddressed());
+
+        receiveFrame(0x34, true);
+        CHECK(!dev.isAddressed());
+        CHECK(memAt(Usart0Regs::UCSRA) & MPCM);
+
+        receiveFrame(0x12, true);
+        CHECK(dev.isAddressed());
+        CHECK((memAt(Usart0Regs::UCSRA) & MPCM) == 0);
+        receiveFrame('a', false);
+        receiveFrame('b', false);
+
+        receiveFrame(0x00, true);
+        CHECK(dev.isAddressed());
+        receiveFrame('c', false);
+
+        receiveFrame(0x13, true);
+        CHECK(!dev.isAddressed());
+        CHECK(memAt(Usart0Regs::UCSRA) & MPCM);
+        receiveFrame('x', false);
+
+        CHECK(dev.available() == 3);
+        CHECK(dev.rx() == 'a');
+        CHECK(dev.rx() == 'b');
+        CHECK(dev.rx() == 'c');
+
+        dev.disableMultiprocessorMode();
+        CHECK((memAt(Usart0Regs::UCSRA) & MPCM) == 0);
+        CHECK((memAt(Usart0Regs::UCSRB) & UCSZ2) == 0);
+        receiveFrame('d', false);
+        CHECK(dev.rx() == 'd');
+    }
+
+    SECTION("master")
+    {
+        dev.enableMultiprocessorMode();
+        CHECK((memAt(Usart0Regs::UCSRA) & MPCM) == 0);
+
+        writeMemAt(Usart0Regs::UCSRA) |= 1 << 5; // UDRE
+        dev.sendAddress(0x12);
+        CHECK(memAt(Usart0Regs::UDR) == 0x12);
+        CHECK((memAt(Usart0Regs::UCSRB) & 0x01) == 0); // TXB8 back to data frames
+
+        receiveFrame('r', false);
+        CHECK(dev.rx() == 'r');
+    }
+}
+
+TEST_CASE("Avr Usart - Statistics")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    receive(dev, 'a');
+    writeMemAt(Usart0Regs::UCSRA) = (1 << 4) | (1 << 3); // FE, DOR
+    receive(dev, 'b');
+    writeMemAt(Usart0Regs::UCSRA) = 1 << 2; // UPE
+    receive(dev, 'c');
+    writeMemAt(Usart0Regs::UCSRA) = 0;
+    dev.rx();
+
+    for (int i = 0; i < AvrUsart::rxBufferSize; ++i)
+        receive(dev, 'x');
+
+    dev.tx('1');
+    dev.tx('2');
+    transmit(dev);
+    transmit(dev);
+    dev.isr();
+    dev.txIsr();
+
+    auto stats = dev.getStats();
+    CHECK(stats.bytesReceived == 3 + AvrUsart::rxBufferSize);
+    CHECK(stats.rxIsrCount == 3 + AvrUsart::rxBufferSize);
+    CHECK(stats.framingErrors == 1);
+    CHECK(stats.overruns == 1);
+    CHECK(stats.parityErrors == 1);
+    CHECK(stats.rxHighWater == AvrUsart::rxBufferSize);
+    CHECK(stats.rxDropped == 2);
+    CHECK(stats.bytesSent == 2);
+    CHECK(stats.txHighWater == 2);
+    CHECK(stats.udreIsrCount == 3);
+    CHECK(stats.txIsrCount == 1);
+
+    dev.resetStats();
+    stats = dev.getStats();
+    CHECK(stats.bytesReceived == 0);
+    CHECK(stats.rxHighWater == 0);
+}
+
+TEST_CASE("Avr Usart - RS-485 driver enable")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    constexpr uint16_t PORTD = 0x2B;
+    constexpr uint8_t  TXC = 1 << 6;
+    constexpr uint8_t  TXCIE = 1 << 6;
+
+    AvrGpioRegs regs {sfr8(0x29), sfr8(0x2A), sfr8(PORTD), sfr8(0)};
+    GpioSpec    spec {regs, 2};
+    Gpio        de(spec, spec.pin);
+
+    const auto isDriverEnabled = [&]() { return (memAt(PORTD) & (1 << 2)) != 0; };
+
+    SECTION("without guard time")
+    {
+        dev.enableRs485(de);
+        CHECK(memAt(Usart0Regs::UCSRB) & TXCIE);
+        CHECK(!isDriverEnabled());
+
+        writeMemAt(Usart0Regs::UCSRA) = TXC | (1 << 1) | (1 << 4); // stale TXC, U2X, FE
+        dev.tx('a');
+        CHECK(isDriverEnabled());
+        CHECK(memAt(Usart0Regs::UCSRA) == (TXC | (1 << 1))); // TXC cleared by writing 1
+
+        dev.tx('b');
+        transmit(dev);
+        dev.txIsr(); // 'b' still queued
+        CHECK(isDriverEnabled());
+
+        transmit(dev);
+        dev.isr();
+        dev.txIsr();
+        CHECK(!isDriverEnabled());
+
+        dev.disableRs485();
+        CHECK((memAt(Usart0Regs::UCSRB) & TXCIE) == 0);
+        dev.tx('c');
+        CHECK(!isDriverEnabled());
+    }
+
+    SECTION("with guard time")
+    {
+        struct MockTimer : Timer {
+            IrqHandler handler {nullptr, nullptr};
+            bool       enabled = false;
+
+            auto enablePeriodicInterrupt(unsigned long, float, const IrqHandler &h)
+                -> bool override
+            {
+                handler = h;
+                enabled = true;
+                return true;
+            }
+            auto disablePeriodicInterrupt() -> void override { enabled = false; }
+            auto restartPeriodicInterrupt() -> void override { enabled = true; }
+            auto stop() -> void override {}
+        } timer;
+
+        REQUIRE(dev.enableRs485(de, timer, F_CPU, 0.001f));
+        CHECK(!timer.enabled);
+
+        dev.tx('a');
+        transmit(dev);
+        dev.isr();
+        dev.txIsr();
+        CHECK(isDriverEnabled());
+        CHECK(timer.enabled);
+
+        // New data during the guard time keeps the driver enabled
+        dev.tx('b');
+        CHECK(!timer.enabled);
+        transmit(dev);
+        dev.isr();
+        dev.txIsr();
+        CHECK(timer.enabled);
+
+        timer.handler();
+        CHECK(!timer.enabled);
+        CHECK(!isDriverEnabled());
+    }
+}
+
+TEST_CASE("Avr Usart - RTS/CTS flow control")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    constexpr uint16_t PINB = 0x23;
+    constexpr uint16_t PORTB = 0x25;
+    constexpr uint16_t PCMSK0 = 0x6B;
+
+    AvrGpioRegs regs {sfr8(PINB), sfr8(0x24), sfr8(PORTB), sfr8(PCMSK0)};
+    GpioSpec    rtsSpec {regs, 0};
+    GpioSpec    ctsSpec {regs, 1, {1, 1}};
+    Gpio        rts(rtsSpec, rtsSpec.pin);
+    Gpio        cts(ctsSpec, ctsSpec.pin);
+
+    // PCINT0 has its own slot, it used to share one with the Timer4 compare interrupt
+    static int timerCalls = 0;
+    timerCalls = 0;
+    installIrqHandler(Irq::Timer4CompA, {[](void *) { ++timerCalls; }, nullptr});
+
+    dev.enableFlowControl(rts, cts);
+    CHECK(memAt(PCMSK0) == (1 << 1));
+    CHECK(cts.getIrq() == Irq::Pcint0);
+    mockIrqHandler(Irq::Timer4CompA)();
+    CHECK(timerCalls == 1);
+
+    SECTION("RTS")
+    {
+        const auto isRtsHigh = [&]() { return (memAt(PORTB) & 1) != 0; };
+
+        for (int i = 0; i < AvrUsart::rtsStopLevel - 1; ++i)
+            receive(dev, 'x');
+        CHECK(!isRtsHigh());
+        receive(dev, 'x');
+        CHECK(isRtsHigh());
+
+        uint8_t buf[AvrUsart::rxBufferSize];
+        dev.read(buf, AvrUsart::rtsStopLevel - AvrUsart::rtsResumeLevel - 1);
+        CHECK(isRtsHigh());
+        dev.rx();
+        CHECK(!isRtsHigh());
+    }
+
+    SECTION("CTS")
+    {
+        writeMemAt(PINB) = 1 << 1; // Peer not ready
+        dev.tx('a');
+        CHECK(!isUdrieSet());
+
+        writeMemAt(PINB) = 0;
+        mockIrqHandler(cts.getIrq())();
+        CHECK(isUdrieSet());
+        CHECK(transmit(dev) == 'a');
+
+        dev.tx('b');
+        writeMemAt(PINB) = 1 << 1;
+        mockIrqHandler(cts.getIrq())();
+        CHECK(!isUdrieSet());
+
+        dev.disableFlowControl();
+        CHECK(isUdrieSet());
+        CHECK(memAt(PCMSK0) == 0);
+    }
+}
+
+TEST_CASE("Avr Usart - TX from program memory")
+{
+    mockMemReset();
+    Usart::Impl dev(Usart0Regs::UCSRA);
+    dev.setupUart(F_CPU, 19200);
+
+    const auto str = FLASH_STR("flash");
+    CHECK(str.length() == 5);
+    CHECK(str[1] == 'l');
+
+    int completed = 0;
+    dev.tx('>');
+    dev.tx(str, {[](void *n) { ++*static_cast<int *>(n); }, &completed});
+    dev.tx('<');
+    dev.tx(FLASH_STR(""));
+
+    const char expected[] = ">flash<";
+    for (size_t i = 0; i < strlen(expected); ++i)
+        CHECK(transmit(dev) == expected[i]);
+    CHECK(completed == 1);
+
+    dev.isr();
+    CHECK(!isUdrieSet());
+}
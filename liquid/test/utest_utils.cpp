@@ -1,5 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include "mockAvr.h"
+#include <Sys.h>
 #include <string.h>
 #include <util.h>
 #include <vector>
@@ -110,4 +112,47 @@ TEST_CASE("Result chaining (void) - 2 successes")
     CHECK(callOrder.size() == 2);
     CHECK(callOrder[0] == 1);
     CHECK(callOrder[1] == 2);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Sys::waitUntil sleeps until an interrupt makes the condition true")
+{
+    mockMemReset();
+
+    struct Flag {
+        int  interrupts = 0;
+        bool set = false;
+    } flag;
+
+    // The third interrupt sets the flag
+    mockSleep.wakeHandler = {[](void *f) {
+                                 auto flag_ = static_cast<Flag *>(f);
+                                 flag_->set = ++flag_->interrupts == 3;
+                             },
+                             &flag};
+
+    Sys::enableInterrupts();
+
+    int checks = 0;
+    Sys::waitUntil(
+        [&] {
+            ++checks;
+            CHECK(Sys::areInterruptsEnabled() == false);
+            return flag.set;
+        },
+        Sys::SleepMode::AdcNoiseReduction);
+
+    CHECK(checks == 4);
+    CHECK(mockSleep.count == 3);
+    CHECK(mockSleep.lastMode == Sys::SleepMode::AdcNoiseReduction);
+    CHECK(Sys::areInterruptsEnabled() == true);
+
+    SECTION("Spins with the interrupts disabled")
+    {
+        Sys::disableInterrupts();
+        checks = 0;
+        Sys::waitUntil([&] { return ++checks == 5; });
+
+        CHECK(mockSleep.count == 3);
+        CHECK(Sys::areInterruptsEnabled() == false);
+    }
+}
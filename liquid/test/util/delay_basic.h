@@ -0,0 +1,9 @@
+// Host replacement for avr-libc's <util/delay_basic.h>, delays take no time.
+#ifndef MOCK_DELAY_BASIC_H_
+#define MOCK_DELAY_BASIC_H_
+
+#include <stdint.h>
+
+inline auto _delay_loop_1(uint8_t) -> void {}
+
+#endif
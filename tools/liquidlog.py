@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""Host side of liquid's deferred binary logging (BinaryLog.h).
+
+Build the table of log sites from the linked program, after each build.
+liquid_log_table(target) in CMake adds this as a post-link step:
+
+    liquidlog.py table app.elf -o app.log.json
+
+Decode the log stream, with the serial port already set to raw mode and the
+right baud rate (e.g. stty -F /dev/ttyUSB0 19200 raw -echo):
+
+    liquidlog.py decode app.log.json < /dev/ttyUSB0
+
+The table argument may also be the ELF file itself.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"\xa5LoG"
+TYPES = "?bBhHiIqQfdcs"
+
+
+def site_id(types, fmt):
+    """16-bit FNV-1a of the type codes, NUL and the format string, see LogSite::hash()."""
+    h = 2166136261
+    for b in types.encode() + b"\0" + fmt.encode():
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return (h ^ (h >> 16)) & 0xFFFF
+
+
+def scan_records(image):
+    """Find the LogSite records in a program image (ELF or raw binary)."""
+    sites = {}
+    pos = image.find(MAGIC)
+    while pos >= 0:
+        record = parse_record(image, pos + len(MAGIC))
+        if record is not None:
+            ident, types, fmt = record
+            known = sites.get(ident)
+            if known is not None and known != (types, fmt):
+                raise SystemExit(
+                    "log ID collision 0x%04x: %r and %r, reword one of them"
+                    % (ident, known[1], fmt))
+            sites[ident] = (types, fmt)
+        pos = image.find(MAGIC, pos + 1)
+    return sites
+
+
+def parse_record(image, pos):
+    if pos + 2 > len(image):
+        return None
+    ident = image[pos] | image[pos + 1] << 8
+    types_end = image.find(b"\0", pos + 2)
+    fmt_end = image.find(b"\0", types_end + 1) if types_end >= 0 else -1
+    if fmt_end < 0:
+        return None
+    try:
+        types = image[pos + 2:types_end].decode("ascii")
+        fmt = image[types_end + 1:fmt_end].decode("utf-8")
+    except UnicodeDecodeError:
+        return None
+    if any(t not in TYPES for t in types) or site_id(types, fmt) != ident:
+        return None
+    return ident, types, fmt
+
+
+def load_table(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(b"\x7fELF"):
+        return scan_records(data)
+    table = json.loads(data)
+    return {int(k, 0): (v["types"], v["format"]) for k, v in table["sites"].items()}
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, see Crc16.h."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def unpack_args(types, data):
+    args = []
+    pos = 0
+    for t in types:
+        if t == "s":
+            end = data.index(b"\0", pos)
+            args.append(data[pos:end].decode("utf-8", "replace"))
+            pos = end + 1
+        elif t == "c":
+            args.append(chr(data[pos]))
+            pos += 1
+        else:
+            size = struct.calcsize("<" + t)
+            value = struct.unpack_from("<" + t, data, pos)[0]
+            # Hex and binary print the two's complement of the device's width
+            args.append(int(value) if t == "?" else (value, 8 * size) if t.islower() else value)
+            pos += size
+    return args
+
+
+def format_field(spec, value):
+    """One {:[0][width][.precision][type]} field, as format() prints it on the device."""
+    zero = spec.startswith("0")
+    spec = spec[1:] if zero else spec
+    kind = spec[-1] if spec and spec[-1] in "dxXbc" else ""
+    spec = spec[:len(spec) - len(kind)]
+    width, _, precision = spec.partition(".")
+    width = int(width or 0)
+    precision = int(precision or 0)
+
+    bits = 64
+    if isinstance(value, tuple):
+        value, bits = value
+
+    if isinstance(value, str) and kind == "":
+        return value.rjust(width)
+    if kind == "c" or (kind == "" and isinstance(value, str)):
+        text = value if isinstance(value, str) else chr(value)
+        return text.rjust(width)
+    if isinstance(value, str):
+        value = ord(value)
+
+    if isinstance(value, float):
+        text = "%.*f" % (precision, value) if precision else repr(value)
+    elif kind in ("x", "X", "b"):
+        text = format(value & ((1 << bits) - 1), kind)
+    elif precision:
+        digits = str(abs(value)).rjust(precision + 1, "0")
+        text = ("-" if value < 0 else "") + digits[:-precision] + "." + digits[-precision:]
+    else:
+        text = str(value)
+
+    if zero:
+        sign = "-" if text.startswith("-") else ""
+        return sign + text[len(sign):].rjust(width - len(sign), "0")
+    return text.rjust(width)
+
+
+def format_message(fmt, args):
+    out = []
+    i = 0
+    args = iter(args)
+    while i < len(fmt):
+        c = fmt[i]
+        if c in "{}" and fmt[i + 1:i + 2] == c:
+            out.append(c)
+            i += 2
+        elif c == "{":
+            end = fmt.index("}", i)
+            field = fmt[i + 1:end]
+            out.append(format_field(field[1:] if field.startswith(":") else field, next(args)))
+            i = end + 1
+        else:
+            out.append(c)
+            i += 1
+    return "".join(out)
+
+
+def decode_frame(sites, frame):
+    payload = cobs_decode(frame)
+    if payload is None or len(payload) < 4 or crc16(payload) != 0:
+        return "# bad frame: " + frame.hex()
+    payload = payload[:-2]
+    ident = payload[0] | payload[1] << 8
+    if ident not in sites:
+        return "# unknown log 0x%04x: %s" % (ident, payload[2:].hex())
+    types, fmt = sites[ident]
+    try:
+        return format_message(fmt, unpack_args(types, payload[2:]))
+    except (ValueError, struct.error, StopIteration):
+        return "# truncated log 0x%04x: %s" % (ident, payload[2:].hex())
+
+
+def cmd_table(args):
+    with open(args.elf, "rb") as f:
+        sites = scan_records(f.read())
+    table = {"sites": {"0x%04x" % k: {"types": t, "format": f}
+                       for k, (t, f) in sorted(sites.items())}}
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump(table, out, indent=2)
+    out.write("\n")
+    if args.output:
+        out.close()
+
+
+def cmd_decode(args):
+    sites = load_table(args.table)
+    stream = open(args.input, "rb", buffering=0) if args.input else sys.stdin.buffer
+    frame = bytearray()
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        if chunk[0] != 0:
+            frame += chunk
+            continue
+        if frame:
+            print(decode_frame(sites, bytes(frame)).rstrip("\r\n"), flush=True)
+        frame = bytearray()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    table = sub.add_parser("table", help="collect the log sites of a linked program")
+    table.add_argument("elf")
+    table.add_argument("-o", "--output", help="write the table here, default stdout")
+    table.set_defaults(func=cmd_table)
+
+    decode = sub.add_parser("decode", help="turn a log stream back into text")
+    decode.add_argument("table", help="table from the table command, or the ELF file")
+    decode.add_argument("input", nargs="?", help="serial device or capture, default stdin")
+    decode.set_defaults(func=cmd_decode)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()